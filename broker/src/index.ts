@@ -36,16 +36,24 @@ if (ENV_PORT && !Number.isNaN(+ENV_PORT)) {
     PORT = +ENV_PORT;
 }
 
+// PI devices send user descriptors in this encoding (see RequestPIUsersPayload), none are requested by default
+const ENV_DESCRIPTOR_VERSION = 'DESCRIPTOR_VERSION' in process.env ? process.env.DESCRIPTOR_VERSION : null;
+let DESCRIPTOR_VERSION: number | null = null;
+if (ENV_DESCRIPTOR_VERSION && [1, 2, 3].includes(+ENV_DESCRIPTOR_VERSION)) {
+    DESCRIPTOR_VERSION = +ENV_DESCRIPTOR_VERSION;
+}
+
 try {
 
     const server = new WebSocket.Server({
         port: PORT,
     });
 
+    // PI devices, web clients and users of disconnected devices are shared by all connections
+    const messageHandler = new MessageHandler(DESCRIPTOR_VERSION);
     server.on('connection', (socket: WebSocket) => {
         winston.verbose('Socket connection has been established');
 
-        const messageHandler = new MessageHandler();
         const handleMessage = (message: WebSocket.Data) => {
             messageHandler.handle(socket, message);
         };
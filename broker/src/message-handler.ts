@@ -16,6 +16,9 @@ import {
     ErrorStatusPayload,
     UpdatePIUsersPayload,
     UpdatePIDevicesPayload,
+    UserAddedPayload,
+    UserRemovedPayload,
+    RequestPIUsersPayload,
 
     User,
     WebClient,
@@ -29,17 +32,27 @@ function userIsValid(user: User): boolean {
         && typeof (user.passport) === 'string'
         && ['string', 'undefined'].includes(typeof (user.patronymic))
         && ['string', 'undefined'].includes(typeof (user.image))
-        && ['number', 'undefined'].includes(typeof (user.id));
+        && ['number', 'undefined'].includes(typeof (user.id))
+        && (['string', 'undefined'].includes(typeof (user.descriptor)) || Array.isArray(user.descriptor));
+}
+
+// Descriptors are kept for the device users, web clients don't need them
+function withoutDescriptor(user: User): User {
+    const { descriptor, ...rest } = user;
+    return rest;
 }
 
 class InMemoryStorage {
     private webClients: Map<WebSocket, WebClient>;
     private piDevices: Map<WebSocket, PIDevice>;
+    // users of disconnected PI devices by their name and pin, a reconnected device with the same hash gets them back
+    private knownUsers: Map<string, { hash: string; users: User[] }>;
     private idGenerator: number;
 
     public constructor() {
         this.webClients = new Map();
         this.piDevices = new Map();
+        this.knownUsers = new Map();
         this.idGenerator = 0;
     }
 
@@ -70,6 +83,8 @@ class InMemoryStorage {
             pin,
             name,
             users: [],
+            revision: null,
+            hash: null,
             id: generatedID,
             socket: piDeviceSocket,
         });
@@ -98,9 +113,20 @@ class InMemoryStorage {
         if (piDevice) {
             winston.info(`PI device ${piDevice.id} has been forgot`);
             this.piDevices.delete(piDeviceSocket);
+            if (piDevice.hash !== null) {
+                this.knownUsers.set(`${piDevice.name}:${piDevice.pin}`, {
+                    hash: piDevice.hash,
+                    users: piDevice.users,
+                });
+            }
         }
     }
 
+    public getKnownUsers(name: string, pin: string, hash: string): User[] | null {
+        const known = this.knownUsers.get(`${name}:${pin}`);
+        return known && known.hash === hash ? known.users : null;
+    }
+
     public getPIDeviceByID(deviceID: number): PIDevice | undefined {
         const [piDevice] = Array.from(this.piDevices.values())
             .filter((instance: PIDevice): boolean => (
@@ -121,8 +147,17 @@ class InMemoryStorage {
 
 export default class MessageHandler {
     private storage: InMemoryStorage;
-    public constructor() {
+    private descriptorVersion: number | null;
+    public constructor(descriptorVersion: number | null = null) {
         this.storage = new InMemoryStorage();
+        this.descriptorVersion = descriptorVersion;
+    }
+
+    private descriptorRequest(): RequestPIUsersPayload {
+        return this.descriptorVersion === null ? {} : {
+            descriptors: true,
+            descriptorVersion: this.descriptorVersion,
+        };
     }
 
     private parseMessage(message: WebSocket.Data): InboundMessage<any> {
@@ -154,7 +189,7 @@ export default class MessageHandler {
             type: OutboundMessageTypes.UPDATE_PI_USERS,
             payload: {
                 deviceID,
-                users,
+                users: users.map(withoutDescriptor),
             },
         };
 
@@ -210,11 +245,16 @@ export default class MessageHandler {
         socket.send(JSON.stringify(body));
     }
 
-    private answerOK(socket: WebSocket, message: InboundMessage<any>): void {
+    private answerOK(
+        socket: WebSocket,
+        message: InboundMessage<any>,
+        details: Omit<OKStatusPayload, 'for'> = {},
+    ): void {
         const body: OutboundMessage<OKStatusPayload> = {
             type: OutboundMessageTypes.OK_STATUS,
             payload: {
                 for: message.type,
+                ...details,
             },
         };
 
@@ -228,15 +268,34 @@ export default class MessageHandler {
         const {
             pin,
             name,
+            revision,
+            hash,
         } = message?.payload;
 
-        const valid = typeof(name) === 'string' && typeof(pin) === 'string';
+        const valid = typeof(name) === 'string' && typeof(pin) === 'string'
+            && ['number', 'undefined'].includes(typeof (revision))
+            && ['string', 'undefined'].includes(typeof (hash));
         if (!valid) {
             throw new Error('Bad message. Data has invalid format for this message type');
         }
 
         this.storage.addPIDevice(piDeviceSocket, name, pin);
-        this.answerOK(piDeviceSocket, message);
+        const piDevice = this.storage.getPIDevice(piDeviceSocket) as PIDevice; // has been just added
+
+        // A reconnected device with unchanged users doesn't send them again
+        const knownUsers = typeof (hash) === 'string' && typeof (revision) === 'number'
+            ? this.storage.getKnownUsers(name, pin, hash) : null;
+        if (knownUsers) {
+            piDevice.users = knownUsers;
+            piDevice.revision = revision as number;
+            piDevice.hash = hash as string;
+            winston.info(`Users of PI device ${piDevice.id} are up to date, revision ${revision}`);
+        }
+        // The device keeps sending descriptors in the requested encoding during this connection
+        this.answerOK(piDeviceSocket, message, {
+            upToDate: knownUsers !== null,
+            ...this.descriptorRequest(),
+        });
 
         piDeviceSocket.once('close', () => {
             this.storage.removePIDevice(piDeviceSocket);
@@ -270,20 +329,105 @@ export default class MessageHandler {
 
         const {
             users,
+            revision,
+            hash,
         } = message.payload;
 
         const valid = Array.isArray(users) && users
-            .every((user: User): boolean => userIsValid(user));
+            .every((user: User): boolean => userIsValid(user))
+            && ['number', 'undefined'].includes(typeof (revision))
+            && ['string', 'undefined'].includes(typeof (hash));
         if (!valid) {
             throw new Error('Bad message. Data has invalid format for this message type');
         }
 
         piDevice.users = users;
-        winston.info(`Users have been updated for PI device ${piDevice.id}`);
+        piDevice.revision = typeof (revision) === 'number' ? revision : null;
+        piDevice.hash = typeof (hash) === 'string' ? hash : null;
+        winston.info(`Users have been updated for PI device ${piDevice.id} to revision ${piDevice.revision}`);
         this.answerOK(piDeviceSocket, message);
         this.updatePIUsersOnWebClients(piDevice.id, piDevice.users);
     }
 
+    private requestPIUsers(piDevice: PIDevice): void {
+        winston.info(`Users of PI device ${piDevice.id} are stale, requesting the full list`);
+        const message: OutboundMessage<RequestPIUsersPayload> = {
+            type: OutboundMessageTypes.REQUEST_PI_USERS,
+            payload: this.descriptorRequest(),
+        };
+
+        piDevice.socket.send(JSON.stringify(message));
+    }
+
+    // Deltas are applied only on top of the previous revision, a missed one makes the broker request the full list
+    private handleUserAdded(
+        piDeviceSocket: WebSocket,
+        message: InboundMessage<UserAddedPayload>)
+    : void {
+        const piDevice = this.storage.getPIDevice(piDeviceSocket);
+        if (!piDevice) {
+            throw new Error('Bad request. PI device is unknown');
+        }
+
+        const {
+            user,
+            revision,
+            hash,
+        } = message.payload;
+
+        const valid = userIsValid(user) && typeof (user.id) === 'number' && typeof (revision) === 'number';
+        if (!valid) {
+            throw new Error('Bad message. Data has invalid format for this message type');
+        }
+
+        this.answerOK(piDeviceSocket, message);
+        if (piDevice.revision === null || revision !== piDevice.revision + 1) {
+            this.requestPIUsers(piDevice);
+            return;
+        }
+
+        piDevice.users = piDevice.users
+            .filter((existing: User): boolean => existing.id !== user.id)
+            .concat([user]);
+        piDevice.revision = revision;
+        piDevice.hash = typeof (hash) === 'string' ? hash : null;
+        winston.info(`User ${user.id} has been added to PI device ${piDevice.id}, revision ${revision}`);
+        this.updatePIUsersOnWebClients(piDevice.id, piDevice.users);
+    }
+
+    private handleUserRemoved(
+        piDeviceSocket: WebSocket,
+        message: InboundMessage<UserRemovedPayload>)
+    : void {
+        const piDevice = this.storage.getPIDevice(piDeviceSocket);
+        if (!piDevice) {
+            throw new Error('Bad request. PI device is unknown');
+        }
+
+        const {
+            userID,
+            revision,
+            hash,
+        } = message.payload;
+
+        const valid = typeof (userID) === 'number' && typeof (revision) === 'number';
+        if (!valid) {
+            throw new Error('Bad message. Data has invalid format for this message type');
+        }
+
+        this.answerOK(piDeviceSocket, message);
+        if (piDevice.revision === null || revision !== piDevice.revision + 1) {
+            this.requestPIUsers(piDevice);
+            return;
+        }
+
+        piDevice.users = piDevice.users.filter((existing: User): boolean => existing.id !== userID);
+        piDevice.revision = revision;
+        piDevice.hash = typeof (hash) === 'string' ? hash : null;
+        winston.info(`User ${userID} has been removed from PI device ${piDevice.id}, revision ${revision}`);
+        this.updatePIUsersOnWebClients(piDevice.id, piDevice.users);
+    }
+
     private handleWebClientAuthorization(
         webClientSocket: WebSocket,
         message: InboundMessage<AuthorizeClientPayload>
@@ -369,7 +513,7 @@ export default class MessageHandler {
             piDevice.socket.once('message', waitForResult);
             piDevice.socket.send(JSON.stringify(messageToPI));
 
-            // after that PI device sends UPDATE_PI_USERS and the server makes UPDATE_PI_USERS for all clients
+            // after that PI device sends USER_ADDED and the server makes UPDATE_PI_USERS for all clients
         }
     }
 
@@ -429,7 +573,7 @@ export default class MessageHandler {
             piDevice.socket.once('message', waitForResult);
             piDevice.socket.send(JSON.stringify(messageToPI));
 
-            // after that PI device sends UPDATE_PI_USERS and the server makes UPDATE_PI_USERS for all clients
+            // after that PI device sends USER_REMOVED and the server makes UPDATE_PI_USERS for all clients
         }
     }
 
@@ -450,6 +594,14 @@ export default class MessageHandler {
                 this.handleUpdatePIUsers(socket, message)
                 break;
             }
+            case InboundMessageTypes.USER_ADDED: {
+                this.handleUserAdded(socket, message);
+                break;
+            }
+            case InboundMessageTypes.USER_REMOVED: {
+                this.handleUserRemoved(socket, message);
+                break;
+            }
             case InboundMessageTypes.AUTHORIZE_CLIENT: {
                 this.handleWebClientAuthorization(socket, message);
                 break;
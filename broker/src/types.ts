@@ -4,6 +4,8 @@ export enum InboundMessageTypes {
     CONNECT_PI = 'CONNECT_PI',
     CONNECT_WEB_CLIENT = 'CONNECT_WEB_CLIENT',
     UPDATE_PI_USERS = 'UPDATE_PI_USERS',
+    USER_ADDED = 'USER_ADDED',
+    USER_REMOVED = 'USER_REMOVED',
     AUTHORIZE_CLIENT = 'AUTHORIZE_CLIENT',
     CREATE_PI_USER = 'CREATE_PI_USER',
     REMOVE_PI_USER = 'REMOVE_PI_USER',
@@ -16,6 +18,7 @@ export enum OutboundMessageTypes {
     REMOVE_PI_USER = 'REMOVE_PI_USER',
     UPDATE_PI_DEVICES = 'UPDATE_PI_DEVICES',
     UPDATE_PI_USERS = 'UPDATE_PI_USERS',
+    REQUEST_PI_USERS = 'REQUEST_PI_USERS',
     OK_STATUS = 'OK_STATUS',
     ERROR_STATUS = 'ERROR_STATUS',
 }
@@ -27,6 +30,7 @@ export interface User {
     secondname: string;
     patronymic?: string;
     image?: string; // base64 encoded jpeg
+    descriptor?: number[] | string; // only from PI devices on request, the string is base64 encoded, not sent to web clients
 }
 
 export interface WebClient {
@@ -40,19 +44,45 @@ export interface PIDevice {
     pin: string;
     name: string;
     users: User[];
+    revision: number | null; // revision of the users, null until the first full list
+    hash: string | null; // hash of the users reported by the device
     socket: WebSocket;
 }
 
 export interface ConnectPIPayload { // InboundMessageTypes.CONNECT_PI
     name: string;
     pin: string;
+    revision?: number;
+    hash?: string; // the device doesn't resend users if the server knows users with this hash
 }
 
 export interface UpdatePIUsersPayload { // InboundMessageTypes.UPDATE_PI_USERS (without deviceID), // OutboundMessageTypes.UPDATE_PI_USERS
     deviceID?: number;
+    revision?: number; // only from PI devices
+    hash?: string; // only from PI devices
+    descriptorVersion?: number; // encoding of user descriptors if they were requested, see RequestPIUsersPayload
     users: User[];
 }
 
+export interface UserAddedPayload { // InboundMessageTypes.USER_ADDED
+    revision: number;
+    hash?: string;
+    descriptorVersion?: number; // encoding of the user descriptor if descriptors were requested
+    user: User;
+}
+
+export interface UserRemovedPayload { // InboundMessageTypes.USER_REMOVED
+    revision: number;
+    hash?: string;
+    userID: number;
+}
+
+export interface RequestPIUsersPayload { // OutboundMessageTypes.REQUEST_PI_USERS
+    descriptors?: boolean;
+    // 1 - arrays of numbers (default), 2 - base64 of little-endian float32, 3 - base64 of little-endian float16
+    descriptorVersion?: number;
+}
+
 export interface AuthorizeClientPayload { // InboundMessageTypes.AUTHORIZE_CLIENT
     deviceID: number;
     pin: string;
@@ -87,6 +117,9 @@ export interface OutboundMessage<PayloadType> {
 
 export interface OKStatusPayload { // InboundMessageTypes.OK_STATUS (for: OutboundMessageTypes), // OutboundMessageTypes.OK_STATUS (for: InboundMessageTypes)
     for: InboundMessageTypes | OutboundMessageTypes;
+    upToDate?: boolean; // for CONNECT_PI, the server already has the device users
+    descriptors?: boolean; // for CONNECT_PI, the device sends descriptors of its users, see RequestPIUsersPayload
+    descriptorVersion?: number;
 }
 
 export interface ErrorStatusPayload {
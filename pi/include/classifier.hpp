@@ -2,6 +2,7 @@
 #define CLASSIFIER_HPP
 
 #include <vector>
+#include <future>
 #include <opencv2/core/mat.hpp>
 
 #include "macros_defs.h"
@@ -11,17 +12,73 @@ enum ClassifierType {
     IE_Facenet_V1,
 };
 
+// Supported preprocessing modes
+enum PreprocessingType {
+    // U8 input, the inference engine converts layout, precision and does mean/scale normalization
+    Engine_Preprocessing,
+    // Float input written by a vectorized kernel, used if the device doesn't support the previous one
+    Host_Preprocessing,
+};
+
+// Options of a classificator
+struct ClassifierOptions {
+    // Limits the number of faces processed by one inference call in embed_batch()
+    // Devices other than CPU have no dynamic batching, they always use 1
+    size_t max_batch_size = 1;
+    // Number of infer requests shared by all calls
+    // It limits how many embed(), embed_batch() and embed_async() calls run simultaneously
+    size_t infer_requests = 1;
+    PreprocessingType preprocessing = PreprocessingType::Engine_Preprocessing;
+    // Enables the cache of compiled networks, it makes next starts much faster
+    std::string cache_dir;
+
+    // CPU plugin settings, they are ignored for other devices
+    // Number of streams (CPU_THROUGHPUT_STREAMS): 0 keeps the plugin default, -1 means AUTO
+    // Use at least the same number of infer requests to load all the streams
+    int cpu_streams = 0;
+    // Number of threads (CPU_THREADS_NUM): 0 keeps the plugin default
+    int cpu_threads = 0;
+    // Pin threads to cores (CPU_BIND_THREAD)
+    bool cpu_bind_thread = true;
+};
+
 typedef std::vector<float> FaceDescriptor;
 
 // Interface of a classificator
+// Implementations are thread-safe, every call checks out its own infer request
 class Classifier {
     public:
         virtual float distance(const FaceDescriptor& desc1, const FaceDescriptor& desc2) = 0;
+        // Computes distances between every pair of first_count and second_count descriptors
+        // Descriptors are rows of size floats, result is a first_count x second_count row-major matrix
+        virtual void distance_matrix(
+            const float* first,
+            size_t first_count,
+            const float* second,
+            size_t second_count,
+            size_t size,
+            float* result
+        ) = 0;
         virtual FaceDescriptor embed(const cv::Mat& face) = 0;
+        // Computes descriptors for several faces with as few inference calls as possible
+        virtual std::vector<FaceDescriptor> embed_batch(const std::vector<cv::Mat>& faces) = 0;
+        // The same, but descriptors are written as rows of descriptor_size() floats into the caller buffer
+        // Faces may be ROIs of one frame, they aren't copied
+        virtual void embed_batch(const cv::Mat* faces, size_t count, float* descriptors) = 0;
+        virtual size_t descriptor_size() const = 0;
+        // Starts inference and returns immediately, blocks only if all infer requests are busy
+        // The face image may be released as soon as the function has returned
+        virtual std::future<FaceDescriptor> embed_async(const cv::Mat& face) = 0;
         virtual ~Classifier() {}
 };
 
 // Classificator factory function
-API std::shared_ptr<Classifier> build_classifier(ClassifierType type, const std::string xml, const std::string bin, const std::string device);
+API std::shared_ptr<Classifier> build_classifier(
+    ClassifierType type,
+    const std::string xml,
+    const std::string bin,
+    const std::string device,
+    const ClassifierOptions& options = ClassifierOptions()
+);
 
 #endif
\ No newline at end of file
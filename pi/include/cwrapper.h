@@ -5,14 +5,318 @@
 #include "macros_defs.h"
 
 EXTERN_C
-    // Returns error message if any exception occured else returns NULL
-    // The message is returned only once
+    // Inference engine settings, see ClassifierOptions for the meaning of the fields
+    // Fill it with default_classifier_options() and change what you need
+    typedef struct {
+        int max_batch_size;
+        int infer_requests;
+        int host_preprocessing;
+        const char* cache_dir;
+        int cpu_streams;
+        int cpu_threads;
+        int cpu_bind_thread;
+    } classifier_options;
+
+    // Face rectangle in a frame
+    typedef struct {
+        int x;
+        int y;
+        int width;
+        int height;
+    } face_roi;
+
+    // Opaque classifier instance
+    // Any number of instances may exist, every instance may be used from several threads
+    typedef struct classifier_handle classifier_handle;
+
+    // Returns error message if any exception occured in this thread else returns NULL
+    // The message is returned only once and stays valid until the next call in the same thread
     API const char* receive_error();
 
+    // Writes default classifier settings into options
+    API void default_classifier_options(classifier_options* options);
+
+    // Returns a new classifier or NULL on failure
+    // Options may be NULL to use the default settings
+    API classifier_handle* create_classifier(
+        const char* xml,
+        const char* bin,
+        const char* device,
+        const classifier_options* options
+    );
+
+    // Releases the classifier, NULL is ignored
+    // No other calls with this handle may be running or made after it
+    API void destroy_classifier(classifier_handle* handle);
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Computes embedding for a BGR image into the caller buffer of result_capacity floats
+    API int classifier_embed(
+        classifier_handle* handle,
+        const int height,
+        const int width,
+        const int type,
+        const int step,
+        const unsigned char* data,
+        float* result,
+        const int result_capacity,
+        int* result_size
+    );
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Computes distance between two descriptors
+    API int classifier_distance(
+        classifier_handle* handle,
+        const float* first,
+        const float* second,
+        const int size,
+        float* result
+    );
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Writes number of floats in one descriptor of the classifier
+    API int classifier_descriptor_size(classifier_handle* handle, int* size);
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Computes embeddings for count faces of one BGR frame, faces are read in place without copies
+    // Result is a count x descriptor size row-major matrix in the caller buffer of result_capacity floats
+    API int classifier_embed_rois(
+        classifier_handle* handle,
+        const int height,
+        const int width,
+        const int type,
+        const int step,
+        const unsigned char* data,
+        const face_roi* rois,
+        const int count,
+        float* result,
+        const int result_capacity
+    );
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Computes distances between every pair of first_count and second_count descriptors
+    // Descriptors are rows of size floats, result must have space for first_count x second_count floats
+    API int classifier_distance_matrix(
+        classifier_handle* handle,
+        const float* first,
+        const int first_count,
+        const float* second,
+        const int second_count,
+        const int size,
+        float* result
+    );
+
+    // Result of a gallery search, distance has the same meaning as in classifier_distance()
+    typedef struct {
+        unsigned int id;
+        float distance;
+    } gallery_match;
+
+    // Opaque storage of reference descriptors with fast nearest neighbor search
+    // Searches may run in parallel, modifications wait for them
+    typedef struct face_gallery_handle face_gallery_handle;
+
+    // Returns a new gallery or NULL on failure
+    // The gallery is filled with count descriptors stored as contiguous rows of dimension floats
+    // Pass count = 0 to create an empty gallery
+    API face_gallery_handle* create_gallery(
+        const int dimension,
+        const unsigned int* ids,
+        const float* descriptors,
+        const int count
+    );
+
+    // Releases the gallery, NULL is ignored
+    API void destroy_gallery(face_gallery_handle* handle);
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Adds a descriptor or replaces existing one with the same id
+    API int gallery_add(face_gallery_handle* handle, const unsigned int id, const float* descriptor);
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Removes the descriptor, removed is set to 0 if there is no such id (may be NULL)
+    API int gallery_remove(face_gallery_handle* handle, const unsigned int id, int* removed);
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Writes number of descriptors in the gallery
+    API int gallery_size(face_gallery_handle* handle, int* size);
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Finds up to k nearest descriptors with distance not greater than threshold
+    // Matches are written into the caller buffer of k elements in ascending order of distance
+    API int gallery_search(
+        face_gallery_handle* handle,
+        const float* probe,
+        const int k,
+        const float threshold,
+        gallery_match* matches,
+        int* match_count
+    );
+
+    // Supported face detectors, see DetectorType
+    enum {
+        DETECTOR_HAAR_CASCADE = 0,  // model is a cascade XML file, weights and device aren't used
+        DETECTOR_IE_SSD = 1,        // OpenVINO SSD network
+    };
+
+    // Face detector settings, see DetectorOptions for the meaning of the fields
+    // Fill it with default_detector_options() and change what you need
+    typedef struct {
+        int min_face_size; // 0 is the detector default
+        float scale_factor;
+        int min_neighbors;
+        int detection_width;
+        float confidence;
+        int infer_requests;
+        const char* cache_dir;
+    } detector_options;
+
+    // Opaque face detector, every instance may be used from several threads
+    typedef struct face_detector_handle face_detector_handle;
+
+    // Writes default detector settings into options
+    API void default_detector_options(detector_options* options);
+
+    // Returns a new face detector or NULL on failure, options may be NULL
+    API face_detector_handle* create_detector(
+        const int type,
+        const char* model,
+        const char* weights,
+        const char* device,
+        const detector_options* options
+    );
+
+    // Releases the detector, NULL is ignored
+    API void destroy_detector(face_detector_handle* handle);
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Finds faces in a BGR image, face_count is set to the number of found faces
+    // Only the first capacity faces are written into the caller buffer
+    API int detector_detect(
+        face_detector_handle* handle,
+        const int height,
+        const int width,
+        const int type,
+        const int step,
+        const unsigned char* data,
+        face_roi* faces,
+        const int capacity,
+        int* face_count
+    );
+
+    // Layouts of frames pushed into a pipeline
+    enum {
+        PIPELINE_FRAME_BGR = 0,     // interleaved BGR, step is the row size in bytes
+        PIPELINE_FRAME_NV12 = 1,    // Y plane followed by interleaved UV plane, both with the same step
+        PIPELINE_FRAME_I420 = 2,    // Y plane followed by U and V planes, both with the same step
+    };
+
+    typedef struct {
+        face_roi face;
+        // 0 if nobody in the gallery is closer than the threshold
+        int identified;
+        unsigned int id;
+        float distance;
+    } pipeline_face;
+
+    typedef struct {
+        long long timestamp;
+        const pipeline_face* faces;
+        int face_count;
+        // Number of frames dropped because of overload or a processing failure since the previous result
+        int dropped_frames;
+    } pipeline_result;
+
+    // Called in a pipeline thread for every processed frame in the push order
+    // The result is valid only during the call
+    typedef void (*pipeline_callback)(const pipeline_result* result, void* user_data);
+
+    typedef struct {
+        // Number of frames waiting for every stage, the oldest one is dropped if the queue is full
+        int queue_size;
+        // Maximum distance of an identified face
+        float threshold;
+        // Frames between full-frame detections, 0 searches every full frame
+        int roi_refresh_frames;
+    } pipeline_options;
+
+    // Timings of one pipeline stage
+    typedef struct {
+        // Valid until the next pipeline_statistics() call in the same thread
+        const char* name;
+        long long processed;
+        long long dropped;
+        double average_ms;
+        double p50_ms;
+        double p95_ms;
+        double p99_ms;
+        double max_ms;
+    } pipeline_stage_statistics;
+
+    // Opaque recognition pipeline, detection, embedding and matching run in their own threads
+    typedef struct pipeline_handle pipeline_handle;
+
+    // Writes default pipeline settings into options
+    API void default_pipeline_options(pipeline_options* options);
+
+    // Returns a new pipeline or NULL on failure
+    // The classifier, the gallery and the detector must outlive the pipeline, options may be NULL
+    // The gallery dimension must be the classifier descriptor size
+    API pipeline_handle* create_pipeline(
+        classifier_handle* classifier,
+        face_gallery_handle* gallery,
+        face_detector_handle* detector,
+        const pipeline_options* options,
+        pipeline_callback callback,
+        void* user_data
+    );
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Copies the frame into the pipeline and returns immediately, frames must be pushed from one thread
+    // dropped is set to 1 if an older waiting frame was dropped because the pipeline is busy (may be NULL)
+    API int pipeline_push_frame(
+        pipeline_handle* handle,
+        const int height,
+        const int width,
+        const int format,
+        const int step,
+        const unsigned char* data,
+        const long long timestamp,
+        int* dropped
+    );
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Writes total number of dropped frames
+    API int pipeline_dropped_frames(pipeline_handle* handle, long long* dropped);
+
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Writes timings of up to capacity stages, stage_count is set to the number of stages
+    API int pipeline_statistics(
+        pipeline_handle* handle,
+        pipeline_stage_statistics* statistics,
+        const int capacity,
+        int* stage_count
+    );
+
+    // Processes already accepted frames, stops the pipeline and releases it, NULL is ignored
+    API void destroy_pipeline(pipeline_handle* handle);
+
+    // Functions below work with one library-wide classifier
+    // They are kept for compatibility, new code should use the handle API
+
     // Returns EXIT_SUCCESS or EXIT_FAILURE
     // Initializes the OpenVINO face classifier
     API int init_ie_facenet_v1(const char* xml, const char* bin, const char* device);
 
+    // Returns EXIT_SUCCESS or EXIT_FAILURE
+    // Initializes the OpenVINO face classifier with custom inference engine settings
+    API int init_ie_facenet_v1_with_options(
+        const char* xml,
+        const char* bin,
+        const char* device,
+        const classifier_options* options
+    );
+
     // Returns EXIT_SUCCESS or EXIT_FAILURE
     // Releases the OpenVINO face classifier
     API int release_ie_facenet_v1();
@@ -28,7 +332,7 @@ EXTERN_C
 
     // Returns EXIT_SUCCESS or EXIT_FAILURE
     // Compute embedding for an image
-    // You need to release embedding vector after you used it with free() function
+    // Result must have space for SIZE_OF_IEFACENET_V1 floats
     API int compute_embedding(
         const int height,
         const int width,
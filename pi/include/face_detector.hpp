@@ -0,0 +1,61 @@
+#ifndef FACE_DETECTOR_HPP
+#define FACE_DETECTOR_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+#include "macros_defs.h"
+
+// Supported face detectors list
+enum DetectorType {
+    // OpenCV Haar cascade, the model is a cascade XML file and weights aren't used
+    Haar_Cascade,
+    // OpenVINO SSD network with DetectionOutput layer, e.g. face-detection-retail-0004
+    IE_SSD,
+};
+
+// Options of a face detector
+struct DetectorOptions {
+    // Smaller faces are ignored by all detectors
+    // An empty size is the detector default: 150x150 for the Haar cascade, which is slow and unreliable
+    // on small faces, and no limit for networks, which are trained on small faces too
+    cv::Size min_face_size = cv::Size();
+
+    // Haar cascade settings
+    double scale_factor = 1.5;
+    int min_neighbors = 5;
+    // Wider frames are downscaled to this width for the cascade, 0 keeps the full resolution
+    // Rectangles are returned in the coordinates of the original frame
+    int detection_width = 0;
+
+    // Neural network settings
+    // Minimum confidence of a reported face
+    float confidence = 0.5f;
+    // Number of infer requests shared by all calls, it limits how many detect() calls run simultaneously
+    size_t infer_requests = 1;
+    // Enables the cache of compiled networks, see ClassifierOptions
+    std::string cache_dir;
+};
+
+// Interface of a face detector
+// Implementations are thread-safe
+class FaceDetector {
+    public:
+        // Finds faces in a BGR frame, rectangles always lie inside the frame
+        virtual void detect(const cv::Mat& frame, std::vector<cv::Rect>& faces) = 0;
+        virtual ~FaceDetector() {}
+};
+
+// Face detector factory function
+// Networks share the inference engine with classifiers
+API std::shared_ptr<FaceDetector> build_detector(
+    DetectorType type,
+    const std::string model,
+    const std::string weights = std::string(),
+    const std::string device = std::string("CPU"),
+    const DetectorOptions& options = DetectorOptions()
+);
+
+#endif
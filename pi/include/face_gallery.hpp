@@ -0,0 +1,79 @@
+#ifndef FACE_GALLERY_HPP
+#define FACE_GALLERY_HPP
+
+#include <vector>
+#include <unordered_map>
+
+#include "classifier.hpp"
+#include "macros_defs.h"
+
+// Result of a gallery search
+// Distance has the same meaning as Classifier::distance (angle between descriptors)
+struct GalleryMatch {
+    unsigned int id;
+    float distance;
+};
+
+// Storage of reference face descriptors
+// All descriptors are kept L2-normalized in one aligned row-major matrix,
+// so a search is a single pass of dot products over contiguous memory
+// The class isn't thread-safe, concurrent modifications must be synchronized outside
+class API FaceGallery {
+    private:
+        size_t _dimension;
+        size_t _stride;
+        size_t _size;
+        size_t _capacity;
+        float* _descriptors;
+        // Rows belong to the caller, they are copied before the first modification
+        bool _borrowed;
+        // Dot product kernel chosen for the row size and this CPU
+        float (*_dot)(const float*, const float*, size_t);
+        std::vector<unsigned int> _ids;
+        std::unordered_map<unsigned int, size_t> _rows;
+
+        void reserve(size_t capacity);
+        void own();
+    public:
+        explicit FaceGallery(size_t dimension);
+        // Searches rows prepared by another gallery (see rows()) in place, e.g. rows of a mapped file
+        // Rows must be 64-byte aligned and outlive the gallery or its first modification
+        FaceGallery(size_t dimension, const float* rows, const unsigned int* ids, size_t count);
+        FaceGallery(const FaceGallery&) = delete;
+        FaceGallery& operator=(const FaceGallery&) = delete;
+
+        // Adds a descriptor or replaces existing one with the same id
+        void add(unsigned int id, const FaceDescriptor& descriptor);
+        void add(unsigned int id, const float* descriptor);
+        // Adds count descriptors stored as contiguous rows of dimension() floats
+        void add(const unsigned int* ids, const float* descriptors, size_t count);
+        // Returns false if there is no such id in the gallery
+        bool remove(unsigned int id);
+        void clear();
+
+        bool contains(unsigned int id) const;
+        // Copies the stored descriptor, it is L2-normalized, returns false if there is no such id
+        bool descriptor(unsigned int id, FaceDescriptor& descriptor) const;
+        size_t size() const;
+        size_t dimension() const;
+        // Replaces the entries with a copy of the source ones, e.g. for a snapshot written without locks
+        void assign(const FaceGallery& source);
+        // Normalized rows padded with zeros to stride() floats, in the order of ids()
+        const float* rows() const;
+        const unsigned int* ids() const;
+        size_t stride() const;
+        // Number of floats in a row for the dimension
+        static size_t stride(size_t dimension);
+
+        // Returns up to k nearest descriptors with distance not greater than threshold
+        // Matches are sorted by distance in ascending order
+        std::vector<GalleryMatch> search(const FaceDescriptor& probe, size_t k, float threshold) const;
+        std::vector<GalleryMatch> search(const float* probe, size_t k, float threshold) const;
+        // The same, but matches are written into the caller buffer of k elements
+        // Returns the number of matches
+        size_t search(const float* probe, size_t k, float threshold, GalleryMatch* matches) const;
+
+        ~FaceGallery();
+};
+
+#endif
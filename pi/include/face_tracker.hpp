@@ -0,0 +1,62 @@
+#ifndef FACE_TRACKER_HPP
+#define FACE_TRACKER_HPP
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+#include "macros_defs.h"
+
+struct TrackerOptions {
+    // Minimum intersection over union of a detection and the previous track position
+    float min_iou = 0.3f;
+    // Faces without enough overlap still match if the centroid moved less than this part of the face width
+    float max_centroid_shift = 0.5f;
+    // Number of frames a track survives without detections
+    size_t max_missed = 5;
+    // The face is embedded again after this number of frames, 0 disables refreshing
+    size_t refresh_frames = 30;
+    // The face is embedded again if its area grew by this factor since the last embedding
+    float quality_gain = 1.3f;
+};
+
+struct Track {
+    // Persistent id, it is never reused by the tracker
+    unsigned int id;
+    cv::Rect face;
+    // Number of consecutive frames without detection, 0 means the face is visible in the last frame
+    size_t missed;
+    // The face must be embedded in this frame, the cached identity is outdated or unknown
+    bool embed;
+    // Frames since the last embedding
+    size_t since_embedding;
+    // Face area at the last embedding
+    float embedded_quality;
+
+    // Identity cached by the caller after the embedding
+    bool identified;
+    unsigned int identity;
+    float distance;
+};
+
+// Gives detections persistent track ids by IoU with centroid fallback
+// A face is embedded only when it appears, periodically and when it becomes larger,
+// between embeddings the cached identity is reused
+// The tracker isn't thread-safe
+class API FaceTracker {
+    private:
+        TrackerOptions _options;
+        std::vector<Track> _tracks;
+        std::vector<bool> _matched;
+        unsigned int _next_id;
+    public:
+        explicit FaceTracker(const TrackerOptions& options = TrackerOptions());
+
+        // Associates faces of the next frame with the tracks
+        // Returns all tracks, the ones detected in this frame have missed = 0
+        // Tracks with embed = true expect the caller to embed them and fill the identity
+        std::vector<Track>& update(const std::vector<cv::Rect>& faces);
+        const std::vector<Track>& tracks() const;
+        void clear();
+};
+
+#endif
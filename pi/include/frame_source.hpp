@@ -0,0 +1,40 @@
+#ifndef FRAME_SOURCE_HPP
+#define FRAME_SOURCE_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/videoio/videoio.hpp>
+
+#include "macros_defs.h"
+
+// Frames of a camera, a video file or a directory of images
+// A number is a camera index, a directory is read as images in the name order, anything else is a video
+class API FrameSource {
+    private:
+        cv::VideoCapture _capture;
+        std::vector<std::string> _images;
+        size_t _next_image;
+        bool _camera;
+        // Replay rate, 0 means frames are returned as fast as they are read
+        double _fps;
+        uint64_t _frames;
+        std::chrono::steady_clock::time_point _start;
+    public:
+        // Throws std::runtime_error if the input can't be opened
+        explicit FrameSource(const std::string& input, double fps = 0.);
+        FrameSource(const FrameSource&) = delete;
+        FrameSource& operator=(const FrameSource&) = delete;
+
+        // Waits until the next frame is due at the replay rate, returns false at the end of the input
+        bool read(cv::Mat& frame);
+        // Requests the camera resolution, other inputs keep their size
+        void set_resolution(int width, int height);
+
+        bool is_camera() const;
+        // Frames returned so far
+        uint64_t frames() const;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef GALLERY_FILE_HPP
+#define GALLERY_FILE_HPP
+
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <functional>
+
+#include "face_gallery.hpp"
+#include "macros_defs.h"
+
+// Binary gallery file, all numbers are little-endian
+// Header, ids, metadata (count + 1 offsets and the bytes they point to) and 64-byte aligned descriptor rows
+// Rows are stored exactly as FaceGallery keeps them, so the mapped file is searched without parsing or copying
+struct GalleryFileHeader {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t dimension;
+    // Floats in a row, it is the dimension padded with zeros
+    uint32_t stride;
+    uint32_t reserved;
+    uint64_t count;
+    // Descriptors of different networks can't be compared, zero-padded string
+    char network_version[32];
+    uint64_t ids_offset;
+    uint64_t metadata_offset;
+    uint64_t metadata_size;
+    uint64_t descriptors_offset;
+};
+
+// Gallery file mapped into memory, pages are read by the OS when a search touches them
+class API MappedGallery {
+    private:
+        void* _data;
+        size_t _length;
+        const GalleryFileHeader* _header;
+        const uint64_t* _metadata_offsets;
+        const char* _metadata;
+        std::unique_ptr<FaceGallery> _gallery;
+    public:
+        // Throws std::runtime_error if the file can't be mapped or is damaged
+        explicit MappedGallery(const std::string& path);
+        MappedGallery(const MappedGallery&) = delete;
+        MappedGallery& operator=(const MappedGallery&) = delete;
+
+        std::string network_version() const;
+        size_t dimension() const;
+        // Number of rows in the file, it doesn't change when the gallery is modified
+        size_t size() const;
+        unsigned int id(size_t row) const;
+        // Metadata bytes of the row as they were written
+        std::string metadata(size_t row) const;
+
+        // Searches the file rows in place, the first modification copies them into memory
+        FaceGallery& gallery();
+        const FaceGallery& gallery() const;
+
+        ~MappedGallery();
+};
+
+// Returns metadata of the gallery entry
+typedef std::function<std::string(unsigned int id)> GalleryMetadata;
+
+// Writes the gallery into a temporary file and renames it over path, so readers see the old or the new file
+// The file is synced before the rename and the directory after it
+API void write_gallery_file(
+    const std::string& path,
+    const std::string& network_version,
+    const FaceGallery& gallery,
+    const GalleryMetadata& metadata
+);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef GALLERY_JOURNAL_HPP
+#define GALLERY_JOURNAL_HPP
+
+#include <memory>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "macros_defs.h"
+
+class SyncedFile;
+
+enum class JournalRecordType {
+    Add = 1,
+    Remove = 2
+};
+
+// Change of the gallery, the descriptor and the metadata are empty for a removal
+struct JournalRecord {
+    JournalRecordType type;
+    unsigned int id;
+    std::vector<float> descriptor;
+    std::string metadata;
+};
+
+// Journal of gallery changes made after the last snapshot (see write_gallery_file)
+// Every record is synced before add() or remove() returns, so the cost of a change doesn't depend on the gallery size
+// Records are idempotent: an addition replaces the entry and a removal of a missing entry does nothing,
+// so the journal may be replayed over a snapshot which already contains some of its records
+class API GalleryJournal {
+    private:
+        std::string _path;
+        std::unique_ptr<SyncedFile> _file;
+        size_t _records;
+        // End of the last synced record, a failed append is cut back to it
+        uint64_t _end;
+
+        void append(const JournalRecord& record);
+    public:
+        // Opens or creates the journal, a torn record left by a crash during append is cut off
+        explicit GalleryJournal(const std::string& path);
+        GalleryJournal(const GalleryJournal&) = delete;
+        GalleryJournal& operator=(const GalleryJournal&) = delete;
+
+        void add(unsigned int id, const std::vector<float>& descriptor, const std::string& metadata);
+        void remove(unsigned int id);
+        // Number of records in the journal
+        size_t records() const;
+        // Renames the journal to the path and starts an empty one
+        // The renamed records are kept until a snapshot containing them is written
+        void rotate(const std::string& path);
+
+        ~GalleryJournal();
+};
+
+// Applies records of the journal file in order and returns their number, a missing file has no records
+// Reading stops at the first incomplete or damaged record
+API size_t replay_journal(const std::string& path, const std::function<void(const JournalRecord&)>& apply);
+
+#endif
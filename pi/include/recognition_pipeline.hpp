@@ -0,0 +1,77 @@
+#ifndef RECOGNITION_PIPELINE_HPP
+#define RECOGNITION_PIPELINE_HPP
+
+#include <memory>
+#include <functional>
+#include <opencv2/core/core.hpp>
+
+#include "classifier.hpp"
+#include "face_detector.hpp"
+#include "face_gallery.hpp"
+#include "staged_pipeline.hpp"
+#include "macros_defs.h"
+
+struct RecognitionResult {
+    int64_t timestamp;
+    std::vector<RecognizedFace> faces;
+    // Number of frames dropped because of overload or a processing failure since the previous result
+    size_t dropped_frames;
+};
+
+struct PipelineOptions {
+    // Number of frames waiting for every stage, the oldest one is dropped if the queue is full
+    size_t queue_size = 2;
+    // Maximum distance of an identified face
+    float threshold = 1.f;
+    // Frames between full-frame detections, other frames are searched only around known faces
+    // 0 searches every full frame, see RoiFaceDetector
+    size_t roi_refresh_frames = 0;
+};
+
+// Called in the pipeline thread for every processed frame in the push order
+typedef std::function<void(const RecognitionResult&)> RecognitionCallback;
+// Finds the closest gallery entry, returns false if there is no match within threshold
+typedef std::function<bool(const float* descriptor, float threshold, GalleryMatch& match)> FaceMatcher;
+
+// Recognizes faces in a stream of frames
+// Detection, embedding and matching are stages of StagedPipeline, so they overlap for consecutive frames
+// Old frames are dropped instead of queued when the pipeline can't keep up, so latency stays bounded
+class API RecognitionPipeline {
+    private:
+        std::shared_ptr<Classifier> _classifier;
+        std::shared_ptr<FaceDetector> _detector;
+        FaceMatcher _matcher;
+        RecognitionCallback _callback;
+        PipelineOptions _options;
+        // Dropped frames reported by the previous result
+        size_t _reported_dropped;
+        StagedPipeline _stages;
+
+        bool detect(FramePacket& packet);
+        bool embed(FramePacket& packet);
+        bool match(FramePacket& packet);
+    public:
+        RecognitionPipeline(
+            std::shared_ptr<Classifier> classifier,
+            std::shared_ptr<FaceDetector> detector,
+            FaceMatcher matcher,
+            RecognitionCallback callback,
+            const PipelineOptions& options = PipelineOptions()
+        );
+        RecognitionPipeline(const RecognitionPipeline&) = delete;
+        RecognitionPipeline& operator=(const RecognitionPipeline&) = delete;
+
+        // Copies the frame into the pipeline and returns immediately, frames must be pushed from one thread
+        // Returns false if an older waiting frame was dropped to make room
+        // YUV frames are single channel matrices with height * 3 / 2 rows
+        bool push(const cv::Mat& frame, FrameFormat format, int64_t timestamp);
+        // Total number of dropped frames
+        size_t dropped() const;
+        // Timings of the detect, embed and match stages
+        std::vector<StageStatistics> statistics() const;
+
+        // Processes already accepted frames and stops the threads
+        ~RecognitionPipeline();
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef ROI_FACE_DETECTOR_HPP
+#define ROI_FACE_DETECTOR_HPP
+
+#include <memory>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+#include "face_detector.hpp"
+#include "macros_defs.h"
+
+struct RoiOptions {
+    // Frames between full-frame detections, 0 searches every full frame
+    size_t refresh_frames = 10;
+    // Margin added to every side of a known face, in face sizes
+    float margin = 0.5f;
+};
+
+// Detector of one stream which searches only around the faces found in the previous frame
+// The full frame is searched periodically and whenever the known faces are lost,
+// so a new face is found at most refresh_frames frames late
+// Unlike other detectors it keeps the stream state and isn't thread-safe, the wrapped detector may be shared
+class API RoiFaceDetector: public FaceDetector {
+    private:
+        std::shared_ptr<FaceDetector> _detector;
+        RoiOptions _options;
+        std::vector<cv::Rect> _known;
+        cv::Size _frame_size;
+        size_t _since_full;
+    public:
+        RoiFaceDetector(std::shared_ptr<FaceDetector> detector, const RoiOptions& options = RoiOptions());
+        void detect(const cv::Mat& frame, std::vector<cv::Rect>& faces) override;
+        // The next frame is searched in full
+        void reset();
+};
+
+#endif
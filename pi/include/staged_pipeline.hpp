@@ -0,0 +1,127 @@
+#ifndef STAGED_PIPELINE_HPP
+#define STAGED_PIPELINE_HPP
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <opencv2/core/core.hpp>
+
+#include "macros_defs.h"
+
+// Layouts of frames
+enum FrameFormat {
+    // Interleaved 8-bit BGR
+    BGR_Frame,
+    // Y plane followed by interleaved UV plane, both with the same step
+    NV12_Frame,
+    // Y plane followed by U and V planes, both with the same step
+    I420_Frame,
+};
+
+struct RecognizedFace {
+    cv::Rect face;
+    // False if nobody in the gallery is closer than the threshold
+    bool identified;
+    unsigned int id;
+    float distance;
+};
+
+// Frame and everything stages have found in it
+struct FramePacket {
+    // Number of the frame in the stream
+    uint64_t index = 0;
+    int64_t timestamp = 0;
+    FrameFormat format = FrameFormat::BGR_Frame;
+    cv::Mat frame;
+    std::vector<cv::Rect> faces;
+    // Track id of every face, it is filled by a tracking stage
+    std::vector<unsigned int> tracks;
+    // Rows of descriptors, one per face
+    std::vector<float> descriptors;
+    // Every face has a flag, false means its descriptor wasn't computed for this frame
+    // Empty vector means all faces are embedded
+    std::vector<bool> embedded;
+    std::vector<RecognizedFace> recognized;
+};
+
+// Processes the packet in place, returns false to discard it
+// Exceptions discard the packet too, it is counted as dropped
+typedef std::function<bool(FramePacket&)> StageFunction;
+
+struct StageStatistics {
+    std::string name;
+    // Packets passed to the next stage
+    size_t processed;
+    // Packets discarded by the stage itself
+    size_t discarded;
+    // Packets dropped in the queue in front of the stage or failed in it
+    size_t dropped;
+    double average_ms;
+    // Percentiles of the stage latency, they are accurate to about 6%
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+    double max_ms;
+};
+
+struct PipelineStage;
+template <typename T> class RingBuffer;
+
+// Chain of stages, every stage runs in its own thread
+// Stages are connected by lock-free queues, a full queue drops its oldest packet,
+// so a slow stage never blocks the previous ones and latency stays bounded
+// A lossless pipeline waits for room instead, it is meant for offline processing and benchmarks
+class API StagedPipeline {
+    private:
+        size_t _queue_depth;
+        bool _output;
+        bool _lossless;
+        bool _started;
+        bool _stopped;
+        std::atomic<bool> _stopping;
+        uint64_t _next_index;
+        std::unique_ptr<PipelineStage> _source;
+        std::vector<std::unique_ptr<PipelineStage>> _stages;
+        // Input of every stage and the output of the last one
+        std::vector<std::unique_ptr<RingBuffer<FramePacket>>> _queues;
+
+        void count_drop(size_t queue);
+        // Returns false if an older packet was dropped from the queue
+        bool forward(size_t queue, FramePacket& packet);
+        void run_source();
+        void run_stage(size_t id);
+    public:
+        // The output queue is created only if packets are taken with pop()
+        // The output of a lossless pipeline has to be drained, otherwise the last stage waits for it
+        explicit StagedPipeline(size_t queue_depth = 2, bool output = false, bool lossless = false);
+        StagedPipeline(const StagedPipeline&) = delete;
+        StagedPipeline& operator=(const StagedPipeline&) = delete;
+
+        // Sets the stage which produces packets in its own thread until it returns false
+        // Without it packets are passed with push()
+        void set_source(const std::string& name, StageFunction function);
+        // Appends a stage, stages can't be added after start()
+        void add_stage(const std::string& name, StageFunction function);
+        void start();
+
+        // Never blocks, returns false if an older waiting packet was dropped to make room
+        // A lossless pipeline blocks until the first stage has room
+        // The packet index is assigned by the pipeline
+        bool push(FramePacket packet);
+        // Waits for a packet passed all the stages, returns false when the pipeline is stopped and empty
+        bool pop(FramePacket& packet);
+
+        // Stops the source and waits until all the stages have processed accepted packets
+        void stop();
+
+        // Source statistics go first
+        std::vector<StageStatistics> statistics() const;
+        // Total number of dropped packets
+        size_t dropped() const;
+
+        ~StagedPipeline();
+};
+
+#endif
@@ -0,0 +1,392 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <limits>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <benchmark/benchmark.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "classifier.hpp"
+#include "preprocessing.hpp"
+#include "distance_kernels.hpp"
+#include "base64.hpp"
+#include "users.hpp"
+#include "gallery_journal.hpp"
+
+// Micro benchmarks of the library hot paths
+// The results are printed in JSON, use --benchmark_format=console for humans
+// Classifier benchmarks run only if a model is given: --xml=facenet.xml --bin=facenet.bin [--device=CPU]
+
+static const cv::Size NETWORK_INPUT_SIZE = cv::Size(160, 160);
+static const size_t DESCRIPTOR_SIZE = 128;
+static const char* NETWORK_VERSION = "facenet128";
+
+static cv::Mat random_face() {
+    cv::Mat face(200, 200, CV_8UC3);
+    cv::randu(face, cv::Scalar::all(0), cv::Scalar::all(255));
+    return face;
+}
+
+static FaceDescriptor random_descriptor(size_t size) {
+    static std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+    FaceDescriptor descriptor(size);
+    for (float& value: descriptor) {
+        value = distribution(generator);
+    }
+
+    return descriptor;
+}
+
+// Dispatched kernels without the classifier, the argument is the descriptor size
+static void BM_DistanceKernel(benchmark::State& state, DistanceMetric metric) {
+    const size_t size = state.range(0);
+    const FaceDescriptor first = random_descriptor(size);
+    const FaceDescriptor second = random_descriptor(size);
+    const DistanceKernel kernel = distance_kernel(metric, size);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(kernel(first.data(), second.data(), size));
+    }
+
+    state.SetLabel(distance_kernel_isa());
+}
+BENCHMARK_CAPTURE(BM_DistanceKernel, cosine, DistanceMetric::Cosine_Similarity)
+    ->Arg(DESCRIPTOR_SIZE)->Arg(SIZE_OF_IEFACENET_V1);
+BENCHMARK_CAPTURE(BM_DistanceKernel, squared_l2, DistanceMetric::Squared_L2_Distance)
+    ->Arg(DESCRIPTOR_SIZE)->Arg(SIZE_OF_IEFACENET_V1);
+BENCHMARK_CAPTURE(BM_DistanceKernel, dot, DistanceMetric::Dot_Product)
+    ->Arg(DESCRIPTOR_SIZE)->Arg(SIZE_OF_IEFACENET_V1);
+
+// The same steps as embed() does before inference with host preprocessing
+static void BM_HostPreprocessing(benchmark::State& state) {
+    const cv::Mat face = random_face();
+    cv::Mat resizedFace;
+    std::vector<float> input(3 * NETWORK_INPUT_SIZE.area());
+    for (auto _: state) {
+        cv::resize(face, resizedFace, NETWORK_INPUT_SIZE);
+        bgr_to_planar_rgb(resizedFace, input.data());
+        benchmark::DoNotOptimize(input.data());
+    }
+}
+BENCHMARK(BM_HostPreprocessing);
+
+// The same steps as embed() does before inference with engine preprocessing
+static void BM_EnginePreprocessing(benchmark::State& state) {
+    const cv::Mat face = random_face();
+    cv::Mat resizedFace;
+    cv::Mat input(NETWORK_INPUT_SIZE, CV_8UC3);
+    for (auto _: state) {
+        cv::resize(face, resizedFace, NETWORK_INPUT_SIZE);
+        cv::cvtColor(resizedFace, input, cv::COLOR_BGR2RGB);
+        benchmark::DoNotOptimize(input.data);
+    }
+}
+BENCHMARK(BM_EnginePreprocessing);
+
+// Base64 decoding of an enrollment image, the argument is the size of the encoded JPEG in KB
+static void BM_Base64Decode(benchmark::State& state) {
+    std::mt19937 generator(42);
+    std::vector<unsigned char> image(state.range(0) * 1024);
+    for (unsigned char& value: image) {
+        value = (unsigned char)(generator() & 0xFF);
+    }
+    const std::string encoded = base64_encode(image.data(), (unsigned int)image.size());
+    for (auto _: state) {
+        benchmark::DoNotOptimize(base64_decode(encoded));
+    }
+
+    state.SetBytesProcessed(int64_t(state.iterations()) * encoded.size());
+}
+BENCHMARK(BM_Base64Decode)->Arg(64)->Arg(256);
+
+static json synthetic_users(size_t count) {
+    json body = json::object();
+    body["networkVersion"] = NETWORK_VERSION;
+    body["users"] = json::array();
+    for (size_t i = 0; i < count; i++) {
+        json user;
+        user["id"] = i + 1;
+        user["firstname"] = "Firstname" + std::to_string(i);
+        user["secondname"] = "Secondname" + std::to_string(i);
+        user["patronymic"] = "Patronymic" + std::to_string(i);
+        user["passport"] = std::to_string(1000000000 + i);
+        user["descriptor"] = random_descriptor(DESCRIPTOR_SIZE);
+        body["users"].push_back(user);
+    }
+
+    return body;
+}
+
+// Parsing of already loaded gallery, the argument is the number of users
+static void BM_ParseUsers(benchmark::State& state) {
+    const json body = synthetic_users(state.range(0));
+    for (auto _: state) {
+        std::vector<User> users;
+        users.reserve(body["users"].size());
+        for (const json& source: body["users"]) {
+            User user;
+            user.parseJSON(source);
+            users.push_back(user);
+        }
+        benchmark::DoNotOptimize(users.data());
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_ParseUsers)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Reading of the gallery file as PIApp does on start, the argument is the number of users
+static void BM_ReadUsers(benchmark::State& state) {
+    const std::string filename = "classifier_bench_users_" + std::to_string(state.range(0)) + ".json";
+    {
+        std::ofstream file(filename, std::ios::out);
+        file << synthetic_users(state.range(0)).dump();
+    }
+
+    // read_users() reports to stdout, keep the JSON output clean
+    std::stringstream log;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(log.rdbuf());
+    size_t users_read = 0;
+    for (auto _: state) {
+        const std::vector<User> users = read_users(filename, NETWORK_VERSION);
+        users_read = users.size();
+        log.str(std::string());
+    }
+    std::cout.rdbuf(stdout_buffer);
+    std::remove(filename.c_str());
+
+    if (users_read != size_t(state.range(0))) {
+        state.SkipWithError("Synthetic gallery was not read");
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_ReadUsers)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Users with descriptors of the argument size, they are encoded as people.json and broker messages encode them
+static std::vector<User> synthetic_user_objects(size_t count, size_t dimension) {
+    std::vector<User> users(count);
+    for (size_t i = 0; i < count; i++) {
+        json source;
+        source["id"] = i + 1;
+        source["firstname"] = "Firstname" + std::to_string(i);
+        source["secondname"] = "Secondname" + std::to_string(i);
+        source["passport"] = std::to_string(1000000000 + i);
+        source["descriptor"] = random_descriptor(dimension);
+        users[i].parseJSON(source);
+    }
+    return users;
+}
+
+// Serialization of 1000 users, bytes_per_user is the size of the JSON text
+static void BM_EncodeUsers(benchmark::State& state, DescriptorEncoding encoding) {
+    const std::vector<User> users = synthetic_user_objects(1000, state.range(0));
+    size_t bytes = 0;
+    for (auto _: state) {
+        json body = json::array();
+        for (const User& user: users) {
+            body.push_back(user.toJSON(true, encoding));
+        }
+        bytes = body.dump().size();
+    }
+
+    state.counters["bytes_per_user"] = double(bytes) / users.size();
+    state.SetItemsProcessed(int64_t(state.iterations()) * users.size());
+}
+BENCHMARK_CAPTURE(BM_EncodeUsers, array, DescriptorEncoding::JSON_Array)
+    ->Arg(DESCRIPTOR_SIZE)->Arg(SIZE_OF_IEFACENET_V1)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_EncodeUsers, base64_float32, DescriptorEncoding::Base64_Float32)
+    ->Arg(DESCRIPTOR_SIZE)->Arg(SIZE_OF_IEFACENET_V1)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_EncodeUsers, base64_float16, DescriptorEncoding::Base64_Float16)
+    ->Arg(DESCRIPTOR_SIZE)->Arg(SIZE_OF_IEFACENET_V1)->Unit(benchmark::kMillisecond);
+
+// Parsing of the JSON text of 1000 users back into users
+static void BM_DecodeUsers(benchmark::State& state, DescriptorEncoding encoding) {
+    json body = json::array();
+    for (const User& user: synthetic_user_objects(1000, state.range(0))) {
+        body.push_back(user.toJSON(true, encoding));
+    }
+    const std::string text = body.dump();
+
+    for (auto _: state) {
+        std::vector<User> users;
+        for (const json& source: json::parse(text)) {
+            User user;
+            user.parseJSON(source, encoding);
+            users.push_back(user);
+        }
+        benchmark::DoNotOptimize(users.data());
+    }
+
+    state.counters["bytes_per_user"] = double(text.size()) / body.size();
+    state.SetItemsProcessed(int64_t(state.iterations()) * body.size());
+}
+BENCHMARK_CAPTURE(BM_DecodeUsers, array, DescriptorEncoding::JSON_Array)
+    ->Arg(DESCRIPTOR_SIZE)->Arg(SIZE_OF_IEFACENET_V1)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DecodeUsers, base64_float32, DescriptorEncoding::Base64_Float32)
+    ->Arg(DESCRIPTOR_SIZE)->Arg(SIZE_OF_IEFACENET_V1)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DecodeUsers, base64_float16, DescriptorEncoding::Base64_Float16)
+    ->Arg(DESCRIPTOR_SIZE)->Arg(SIZE_OF_IEFACENET_V1)->Unit(benchmark::kMillisecond);
+
+// Start with the binary gallery: mapping, reading of the users and the first search, which pages the rows in
+// Compare with BM_ReadUsers, the argument is the number of users
+static void BM_MapUsers(benchmark::State& state) {
+    const std::string json_file = "classifier_bench_users_" + std::to_string(state.range(0)) + ".json";
+    const std::string gallery_file = "classifier_bench_users_" + std::to_string(state.range(0)) + ".gallery";
+    {
+        std::ofstream file(json_file, std::ios::out);
+        file << synthetic_users(state.range(0)).dump();
+    }
+
+    std::stringstream log;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(log.rdbuf());
+    convert_users(json_file, gallery_file, NETWORK_VERSION, DESCRIPTOR_SIZE);
+    std::remove(json_file.c_str());
+
+    const FaceDescriptor probe = random_descriptor(DESCRIPTOR_SIZE);
+    size_t users_read = 0;
+    for (auto _: state) {
+        std::vector<User> users;
+        std::unique_ptr<MappedGallery> gallery = read_gallery(gallery_file, NETWORK_VERSION, users);
+        if (gallery) {
+            benchmark::DoNotOptimize(gallery->gallery().search(probe.data(), 1, std::numeric_limits<float>::max()));
+        }
+        users_read = users.size();
+        log.str(std::string());
+    }
+    std::cout.rdbuf(stdout_buffer);
+    std::remove(gallery_file.c_str());
+
+    if (users_read != size_t(state.range(0))) {
+        state.SkipWithError("Synthetic gallery was not mapped");
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_MapUsers)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Persisting of one enrollment by rewriting the JSON users, the argument is the number of users
+static void BM_EnrollRewrite(benchmark::State& state) {
+    const std::string filename = "classifier_bench_enroll_" + std::to_string(state.range(0)) + ".json";
+    std::vector<User> users;
+    for (const json& source: synthetic_users(state.range(0))["users"]) {
+        User user;
+        user.parseJSON(source);
+        users.push_back(user);
+    }
+
+    for (auto _: state) {
+        update_users(users, filename, NETWORK_VERSION);
+    }
+    std::remove(filename.c_str());
+}
+BENCHMARK(BM_EnrollRewrite)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Persisting of one enrollment by a synced journal record, it doesn't depend on the number of users
+static void BM_EnrollJournal(benchmark::State& state) {
+    const std::string filename = "classifier_bench_enroll.journal";
+    const FaceDescriptor descriptor = random_descriptor(DESCRIPTOR_SIZE);
+    User user;
+    user.parseJSON(synthetic_users(1)["users"][0]);
+    std::remove(filename.c_str());
+    unsigned int id = 0;
+    {
+        GalleryJournal journal(filename);
+        for (auto _: state) {
+            journal.add(id++, descriptor, user.toMetadata());
+        }
+    }
+
+    // A reopened journal continues after the existing records, as on PIApp restart
+    GalleryJournal(filename).add(id++, descriptor, user.toMetadata());
+    unsigned int expected = 0;
+    bool ordered = true;
+    const size_t records = replay_journal(filename, [&expected, &ordered](const JournalRecord& record) {
+        ordered = ordered && record.id == expected++;
+    });
+    std::remove(filename.c_str());
+
+    if (!ordered || records != id) {
+        state.SkipWithError("Journal lost records after reopening");
+    }
+}
+BENCHMARK(BM_EnrollJournal)->Unit(benchmark::kMillisecond);
+
+static void BM_Distance(benchmark::State& state, std::shared_ptr<Classifier> classifier) {
+    const FaceDescriptor first = random_descriptor(state.range(0));
+    const FaceDescriptor second = random_descriptor(state.range(0));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(classifier->distance(first, second));
+    }
+}
+
+static void BM_Embed(benchmark::State& state, std::shared_ptr<Classifier> classifier) {
+    const cv::Mat face = random_face();
+    for (auto _: state) {
+        benchmark::DoNotOptimize(classifier->embed(face));
+    }
+}
+
+// Returns value of --name=value argument and removes it from the list
+static std::string take_argument(int& argc, char** argv, const std::string& name) {
+    const std::string prefix = "--" + name + "=";
+    for (int i = 1; i < argc; i++) {
+        const std::string argument = argv[i];
+        if (!argument.compare(0, prefix.size(), prefix)) {
+            for (int j = i; j < argc - 1; j++) {
+                argv[j] = argv[j + 1];
+            }
+            argc--;
+            return argument.substr(prefix.size());
+        }
+    }
+
+    return std::string();
+}
+
+int main(int argc, char* argv[]) {
+    // JSON is the default output, flags given by the user are parsed later and win
+    std::vector<char*> arguments(argv, argv + argc);
+    std::string json_format = "--benchmark_format=json";
+    arguments.insert(arguments.begin() + 1, &json_format[0]);
+    int arguments_count = int(arguments.size());
+
+    const std::string xml = take_argument(arguments_count, arguments.data(), "xml");
+    const std::string bin = take_argument(arguments_count, arguments.data(), "bin");
+    std::string device = take_argument(arguments_count, arguments.data(), "device");
+    if (device.empty()) {
+        device = "CPU";
+    }
+
+    benchmark::Initialize(&arguments_count, arguments.data());
+    if (benchmark::ReportUnrecognizedArguments(arguments_count, arguments.data())) {
+        return EXIT_FAILURE;
+    }
+
+    std::shared_ptr<Classifier> classifier;
+    if (!xml.empty() && !bin.empty()) {
+        classifier = build_classifier(ClassifierType::IE_Facenet_V1, xml, bin, device);
+        benchmark::RegisterBenchmark("BM_Distance", BM_Distance, classifier)
+            ->Arg(DESCRIPTOR_SIZE)->Arg(SIZE_OF_IEFACENET_V1);
+        benchmark::RegisterBenchmark("BM_Embed", BM_Embed, classifier)
+            ->Unit(benchmark::kMillisecond);
+    } else {
+        std::cerr << "Model is not given, classifier benchmarks are skipped" << std::endl;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    return EXIT_SUCCESS;
+}
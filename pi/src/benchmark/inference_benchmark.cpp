@@ -0,0 +1,501 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+#include <opencv2/videoio/videoio.hpp>
+
+#include "classifier.hpp"
+#include "face_detector.hpp"
+#include "preprocessing.hpp"
+#include "roi_face_detector.hpp"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Returns average time of one call in milliseconds, the first call is a warm up
+template <typename Function>
+static double measure_ms(Function function, const int iterations) {
+    function();
+
+    const Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        function();
+    }
+    const Clock::time_point end = Clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+// Returns face image used as inference input
+// Random noise is good enough to measure performance
+static cv::Mat load_face(const std::string& path) {
+    cv::Mat face;
+    if (!path.empty()) {
+        face = cv::imread(path, cv::IMREAD_COLOR);
+    }
+
+    if (face.empty()) {
+        face = cv::Mat(200, 200, CV_8UC3);
+        cv::randu(face, cv::Scalar::all(0), cv::Scalar::all(255));
+    }
+
+    return face;
+}
+
+static const cv::Size NETWORK_INPUT_SIZE = cv::Size(160, 160);
+
+// The original float preprocessing: four passes over the image and allocations for every face
+static void legacy_preprocess(const cv::Mat& face, float* data) {
+    cv::Mat resizedFace;
+    cv::resize(face, resizedFace, NETWORK_INPUT_SIZE);
+
+    cv::Mat floatFace;
+    cv::cvtColor(resizedFace, floatFace, cv::COLOR_BGR2RGB);
+    floatFace.convertTo(floatFace, CV_32FC3);
+
+    const size_t width = NETWORK_INPUT_SIZE.width;
+    const size_t height = NETWORK_INPUT_SIZE.height;
+    const size_t image_size = width * height;
+    for (size_t h = 0; h < height; h++) {
+        for (size_t w = 0; w < width; w++) {
+            for (size_t ch = 0; ch < 3; ch++) {
+                data[ch * image_size + h * width + w] =
+                    (floatFace.at<cv::Vec3f>(h, w)[ch] - 127.5) / 128.0;
+            }
+        }
+    }
+}
+
+static void fused_preprocess(const cv::Mat& face, float* data) {
+    static cv::Mat resizedFace;
+    cv::resize(face, resizedFace, NETWORK_INPUT_SIZE);
+    bgr_to_planar_rgb(resizedFace, data);
+}
+
+static float max_difference(const float* first, const float* second, size_t size) {
+    float difference = 0;
+    for (size_t i = 0; i < size; i++) {
+        difference = std::max(difference, std::abs(first[i] - second[i]));
+    }
+
+    return difference;
+}
+
+// Compares the original float preprocessing with the fused kernel
+// and the host preprocessing with the inference engine one
+static void benchmark_preprocessing(
+    const std::string& xml,
+    const std::string& bin,
+    const std::string& device,
+    const cv::Mat& face,
+    const int iterations
+) {
+    const size_t input_size = 3 * NETWORK_INPUT_SIZE.area();
+    std::vector<float> legacy(input_size), fused(input_size);
+
+    std::cout
+        << "Legacy preprocessing: "
+        << measure_ms([&]() { legacy_preprocess(face, legacy.data()); }, iterations)
+        << " ms per face" << std::endl;
+    std::cout
+        << "Fused preprocessing: "
+        << measure_ms([&]() { fused_preprocess(face, fused.data()); }, iterations)
+        << " ms per face" << std::endl;
+
+    std::cout
+        << "Preprocessed inputs are "
+        << (memcmp(legacy.data(), fused.data(), input_size * sizeof(float)) ? "different" : "identical")
+        << std::endl;
+
+    std::vector<FaceDescriptor> descriptors;
+    const std::vector<std::pair<std::string, PreprocessingType>> modes = {
+        {"Host preprocessing", PreprocessingType::Host_Preprocessing},
+        {"Engine preprocessing", PreprocessingType::Engine_Preprocessing},
+    };
+    for (const auto& mode: modes) {
+        ClassifierOptions options;
+        options.preprocessing = mode.second;
+        const std::shared_ptr<Classifier> classifier = build_classifier(
+            ClassifierType::IE_Facenet_V1, xml, bin, device, options);
+        descriptors.push_back(classifier->embed(face));
+
+        std::cout
+            << mode.first << ": "
+            << measure_ms([&]() { classifier->embed(face); }, iterations)
+            << " ms per embed" << std::endl;
+    }
+
+    std::cout
+        << "Max descriptor difference: "
+        << max_difference(descriptors[0].data(), descriptors[1].data(), descriptors[0].size())
+        << std::endl;
+}
+
+// Measures classifier creation without compiled network cache and with it
+static void benchmark_startup(
+    const std::string& xml,
+    const std::string& bin,
+    const std::string& device,
+    const std::string& cache,
+    const int iterations
+) {
+    ClassifierOptions options;
+    options.cache_dir = cache;
+
+    const double no_cache_ms = measure_ms([&]() {
+        build_classifier(ClassifierType::IE_Facenet_V1, xml, bin, device);
+    }, iterations);
+    std::cout << "Without cache: " << no_cache_ms << " ms" << std::endl;
+
+    // The first start fills the cache
+    const Clock::time_point start = Clock::now();
+    build_classifier(ClassifierType::IE_Facenet_V1, xml, bin, device, options);
+    const Clock::time_point end = Clock::now();
+    std::cout
+        << "Cold start: "
+        << std::chrono::duration<double, std::milli>(end - start).count()
+        << " ms" << std::endl;
+
+    const double warm_ms = measure_ms([&]() {
+        build_classifier(ClassifierType::IE_Facenet_V1, xml, bin, device, options);
+    }, iterations);
+    std::cout << "Warm start: " << warm_ms << " ms" << std::endl;
+}
+
+// Measures throughput of embed_batch() for several batch sizes
+static void benchmark_batch(
+    const std::string& xml,
+    const std::string& bin,
+    const std::string& device,
+    const cv::Mat& face,
+    const int iterations
+) {
+    const std::vector<size_t> batch_sizes = {1, 2, 4, 8};
+    for (const size_t batch_size: batch_sizes) {
+        ClassifierOptions options;
+        options.max_batch_size = batch_size;
+        const std::shared_ptr<Classifier> classifier = build_classifier(
+            ClassifierType::IE_Facenet_V1, xml, bin, device, options);
+        const std::vector<cv::Mat> faces(batch_size, face);
+
+        const double batch_ms = measure_ms([&]() { classifier->embed_batch(faces); }, iterations);
+        const double face_ms = batch_ms / batch_size;
+        std::cout
+            << "Batch " << batch_size << ": "
+            << batch_ms << " ms per batch, "
+            << face_ms << " ms per face, "
+            << 1000. / face_ms << " faces/s"
+            << std::endl;
+    }
+}
+
+static std::vector<int> parse_list(const std::string& list) {
+    std::vector<int> values;
+    std::stringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+        values.push_back(std::stoi(value));
+    }
+
+    return values;
+}
+
+static double percentile(std::vector<double>& values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    const size_t index = std::min(values.size() - 1, size_t(values.size() * fraction));
+    return values[index];
+}
+
+// Sweeps CPU plugin settings and reports throughput and latency of embed_async()
+// The number of infer requests is equal to the number of streams to load all of them
+static void benchmark_streams(
+    const std::string& xml,
+    const std::string& bin,
+    const std::string& device,
+    const cv::Mat& face,
+    const int iterations,
+    const std::vector<int>& streams,
+    const std::vector<int>& threads,
+    const std::vector<int>& bind
+) {
+    for (const int cpu_streams: streams) {
+        for (const int cpu_threads: threads) {
+            for (const int cpu_bind_thread: bind) {
+                ClassifierOptions options;
+                options.cpu_streams = cpu_streams;
+                options.cpu_threads = cpu_threads;
+                options.cpu_bind_thread = cpu_bind_thread != 0;
+                options.infer_requests = std::max(cpu_streams, 1);
+                const std::shared_ptr<Classifier> classifier = build_classifier(
+                    ClassifierType::IE_Facenet_V1, xml, bin, device, options);
+
+                // Warm up
+                classifier->embed(face);
+
+                std::deque<std::pair<Clock::time_point, std::future<FaceDescriptor>>> running;
+                std::vector<double> latencies;
+                latencies.reserve(iterations);
+                const auto wait_oldest = [&]() {
+                    running.front().second.get();
+                    latencies.push_back(std::chrono::duration<double, std::milli>(
+                        Clock::now() - running.front().first).count());
+                    running.pop_front();
+                };
+
+                const Clock::time_point start = Clock::now();
+                for (int i = 0; i < iterations; i++) {
+                    if (running.size() == options.infer_requests) {
+                        wait_oldest();
+                    }
+
+                    const Clock::time_point submitted = Clock::now();
+                    running.emplace_back(submitted, classifier->embed_async(face));
+                }
+
+                while (!running.empty()) {
+                    wait_oldest();
+                }
+                const Clock::time_point end = Clock::now();
+
+                const double total_s = std::chrono::duration<double>(end - start).count();
+                std::cout
+                    << "Streams " << cpu_streams
+                    << ", threads " << cpu_threads
+                    << ", bind " << (options.cpu_bind_thread ? "yes" : "no") << ": "
+                    << iterations / total_s << " faces/s, "
+                    << "p50 " << percentile(latencies, 0.5) << " ms, "
+                    << "p99 " << percentile(latencies, 0.99) << " ms"
+                    << std::endl;
+            }
+        }
+    }
+}
+
+// Returns up to count frames of the video, they are kept in memory so decoding isn't measured
+static std::vector<cv::Mat> load_frames(const std::string& path, const int count) {
+    std::vector<cv::Mat> frames;
+    cv::VideoCapture capture(path);
+    cv::Mat frame;
+    while (int(frames.size()) < count && capture.read(frame)) {
+        frames.push_back(frame.clone());
+    }
+
+    if (frames.empty()) {
+        throw std::runtime_error("Could not read frames from " + path);
+    }
+
+    return frames;
+}
+
+// Runs the Haar cascade and the network detector over the same frames
+static void benchmark_detection(
+    const std::string& xml,
+    const std::string& bin,
+    const std::string& device,
+    const std::string& cascade,
+    const std::vector<cv::Mat>& frames,
+    const int min_face,
+    const int iterations
+) {
+    DetectorOptions options;
+    options.min_face_size = cv::Size(min_face, min_face);
+    const std::vector<std::pair<std::string, std::shared_ptr<FaceDetector>>> detectors = {
+        {"Haar cascade", build_detector(DetectorType::Haar_Cascade, cascade, std::string(), std::string(), options)},
+        {"SSD network", build_detector(DetectorType::IE_SSD, xml, bin, device, options)},
+    };
+
+    std::vector<cv::Rect> faces;
+    for (const auto& detector: detectors) {
+        size_t found = 0;
+        for (const cv::Mat& frame: frames) {
+            detector.second->detect(frame, faces);
+            found += faces.size();
+        }
+
+        const double frames_ms = measure_ms([&]() {
+            for (const cv::Mat& frame: frames) {
+                detector.second->detect(frame, faces);
+            }
+        }, iterations);
+        const double frame_ms = frames_ms / frames.size();
+        std::cout
+            << detector.first << ": "
+            << frame_ms << " ms per frame, "
+            << 1000. / frame_ms << " frames/s, "
+            << found << " faces in " << frames.size() << " frames"
+            << std::endl;
+    }
+}
+
+static float intersection_over_union(const cv::Rect& first, const cv::Rect& second) {
+    const float intersection = float((first & second).area());
+    const float united = float(first.area() + second.area()) - intersection;
+    return united > 0.f ? intersection / united : 0.f;
+}
+
+// Runs the Haar cascade on 720p and 1080p frames at the full resolution, downscaled and around known faces
+// Recall is the share of full resolution faces found again with IoU of at least 0.5
+static void benchmark_resolution(
+    const std::string& cascade,
+    const std::vector<cv::Mat>& frames,
+    const std::vector<int>& widths,
+    const int roi_refresh,
+    const int iterations
+) {
+    typedef std::function<std::shared_ptr<FaceDetector>()> DetectorMaker;
+    const std::vector<cv::Size> resolutions = {cv::Size(1280, 720), cv::Size(1920, 1080)};
+    for (const cv::Size& resolution: resolutions) {
+        std::vector<cv::Mat> scaled(frames.size());
+        for (size_t i = 0; i < frames.size(); i++) {
+            cv::resize(frames[i], scaled[i], resolution, 0, 0, cv::INTER_LINEAR);
+        }
+
+        const std::shared_ptr<FaceDetector> full = build_detector(DetectorType::Haar_Cascade, cascade);
+        std::vector<std::vector<cv::Rect>> expected(scaled.size());
+        size_t expected_count = 0;
+        for (size_t i = 0; i < scaled.size(); i++) {
+            full->detect(scaled[i], expected[i]);
+            expected_count += expected[i].size();
+        }
+
+        std::vector<std::pair<std::string, DetectorMaker>> settings = {
+            {"full", [&]() { return full; }},
+        };
+        for (const int width: widths) {
+            DetectorOptions options;
+            options.detection_width = width;
+            const std::shared_ptr<FaceDetector> downscaled = build_detector(
+                DetectorType::Haar_Cascade, cascade, std::string(), std::string(), options);
+            settings.push_back({"width " + std::to_string(width), [downscaled]() { return downscaled; }});
+            settings.push_back({"width " + std::to_string(width) + " + ROI", [downscaled, roi_refresh]() {
+                RoiOptions roi_options;
+                roi_options.refresh_frames = size_t(roi_refresh);
+                return std::shared_ptr<FaceDetector>(new RoiFaceDetector(downscaled, roi_options));
+            }});
+        }
+        settings.push_back({"ROI", [&]() {
+            RoiOptions roi_options;
+            roi_options.refresh_frames = size_t(roi_refresh);
+            return std::shared_ptr<FaceDetector>(new RoiFaceDetector(full, roi_options));
+        }});
+
+        std::vector<cv::Rect> faces;
+        for (const auto& setting: settings) {
+            // Every pass is a new stream, so ROI detectors start from a full frame
+            std::shared_ptr<FaceDetector> detector = setting.second();
+            size_t found = 0, matched = 0;
+            for (size_t i = 0; i < scaled.size(); i++) {
+                detector->detect(scaled[i], faces);
+                found += faces.size();
+                for (const cv::Rect& reference: expected[i]) {
+                    matched += std::any_of(faces.begin(), faces.end(), [&](const cv::Rect& face) {
+                        return intersection_over_union(face, reference) >= 0.5f;
+                    });
+                }
+            }
+
+            const double frames_ms = measure_ms([&]() {
+                std::shared_ptr<FaceDetector> stream = setting.second();
+                for (const cv::Mat& frame: scaled) {
+                    stream->detect(frame, faces);
+                }
+            }, iterations);
+            const double frame_ms = frames_ms / scaled.size();
+            std::cout
+                << resolution.width << "x" << resolution.height << " " << setting.first << ": "
+                << frame_ms << " ms per frame, "
+                << 1000. / frame_ms << " frames/s, "
+                << found << " faces, recall "
+                << (expected_count ? double(matched) / expected_count : 1.)
+                << std::endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const cv::String keys =
+        "{mode           |batch | batch, preprocessing, startup, streams, detection, resolution}"
+        "{device         |CPU   | backend device (CPU, MYRIAD)}"
+        "{xml            |<none>| path to model definition    }"
+        "{bin            |<none>| path to model weights       }"
+        "{image          |      | face image (random if empty)}"
+        "{iterations     |100   | number of measured runs     }"
+        "{cache          |benchmark_cache| compiled network cache (must be empty for cold start)}"
+        "{streams        |1,2,4 | CPU streams to sweep (-1 is AUTO)}"
+        "{threads        |0     | CPU threads to sweep (0 is default)}"
+        "{bind           |1,0   | CPU thread binding to sweep }"
+        "{cascade        |haarcascade_frontalface_default.xml| Haar cascade for detection mode}"
+        "{video          |      | video for detection mode, xml and bin are the detector network}"
+        "{frames         |100   | number of video frames      }"
+        "{min_face       |0     | minimum face size for detection mode, 0 is the detector default}"
+        "{widths         |960,640| detection widths for resolution mode}"
+        "{roi            |10    | frames between full-frame detections for resolution mode}"
+    ;
+    cv::CommandLineParser parser(argc, argv, keys);
+    const std::string mode = parser.get<std::string>("mode");
+    const std::string device = parser.get<std::string>("device");
+    const std::string xml = parser.get<std::string>("xml");
+    const std::string bin = parser.get<std::string>("bin");
+    const std::string image = parser.get<std::string>("image");
+    const int iterations = parser.get<int>("iterations");
+    const std::string cache = parser.get<std::string>("cache");
+    const std::vector<int> streams = parse_list(parser.get<std::string>("streams"));
+    const std::vector<int> threads = parse_list(parser.get<std::string>("threads"));
+    const std::vector<int> bind = parse_list(parser.get<std::string>("bind"));
+    const std::string cascade = parser.get<std::string>("cascade");
+    const std::string video = parser.get<std::string>("video");
+    const int frames = parser.get<int>("frames");
+    const int min_face = parser.get<int>("min_face");
+    const std::vector<int> widths = parse_list(parser.get<std::string>("widths"));
+    const int roi = parser.get<int>("roi");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+
+    std::cout << "Mode: " << mode << std::endl;
+    std::cout << "Device: " << device << std::endl;
+    std::cout << "Iterations: " << iterations << std::endl;
+
+    const cv::Mat face = load_face(image);
+    if (mode == std::string("batch")) {
+        benchmark_batch(xml, bin, device, face, iterations);
+    } else if (mode == std::string("preprocessing")) {
+        benchmark_preprocessing(xml, bin, device, face, iterations);
+    } else if (mode == std::string("startup")) {
+        benchmark_startup(xml, bin, device, cache, iterations);
+    } else if (mode == std::string("streams")) {
+        benchmark_streams(xml, bin, device, face, iterations, streams, threads, bind);
+    } else if (mode == std::string("detection")) {
+        benchmark_detection(xml, bin, device, cascade, load_frames(video, frames), min_face, iterations);
+    } else if (mode == std::string("resolution")) {
+        benchmark_resolution(cascade, load_frames(video, frames), widths, roi, iterations);
+    } else {
+        std::cout << "Unknown benchmark mode " << mode << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -5,151 +5,175 @@
     Year: 2019
 */
 
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <iostream>
-#include <memory>
-#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
 
-#include <opencv2/objdetect/objdetect.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
-#include <opencv2/videoio/videoio.hpp>
 
 #include "cwrapper.h"
+#include "frame_source.hpp"
+
+// We can't throw exceptions from CPP shared libraries into C code
+// So, we check if something was wrong and get a message
+// The same with other API methods except of receive_error()
+static void check(int status) {
+    if (status == EXIT_FAILURE) {
+        std::cout << receive_error() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// Faces found in the last processed frame
+struct LatestResult {
+    std::mutex mutex;
+    std::vector<pipeline_face> faces;
+};
+
+// Called in a pipeline thread
+static void store_result(const pipeline_result* result, void* user_data) {
+    LatestResult* latest = static_cast<LatestResult*>(user_data);
+    std::lock_guard<std::mutex> lock(latest->mutex);
+    latest->faces.assign(result->faces, result->faces + result->face_count);
+}
 
 // Regardless of we write in C++,
 // In this sample we use C interface of the library
-int main() {
-    // First of all we have to init the classififer
-    int status = init_ie_facenet_v1(
+int main(int argc, char* argv[]) {
+    // First of all we have to create the classififer
+    classifier_handle* classifier = create_classifier(
         "../data/facenet.xml",
         "../data/facenet.bin",
-        "CPU"
+        "CPU",
+        NULL
     );
 
-    // We can't throw exceptions from CPP shared libraries into C code
-    // So, we check if something was wrong and get a message
-    // The same with other API methods except of receive_error()
-    if (status == EXIT_FAILURE) {
+    if (!classifier) {
         std::cout << receive_error() << std::endl;
         std::exit(EXIT_FAILURE);
     }
 
-    std::vector<cv::Rect> faces;
-    cv::VideoCapture capture(0);
-    cv::CascadeClassifier cascade;
-    cv::Mat image, gray, face_image;
+    int descriptor_size = 0;
+    check(classifier_descriptor_size(classifier, &descriptor_size));
 
     // Load face detector
-    cascade.load("../data/haarcascade_frontalface_default.xml");
+    // DETECTOR_IE_SSD with a network and a device selects the neural detector
+    face_detector_handle* detector = create_detector(
+        DETECTOR_HAAR_CASCADE,
+        "../data/haarcascade_frontalface_default.xml",
+        NULL,
+        NULL,
+        NULL
+    );
+
+    if (!detector) {
+        std::cout << receive_error() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Up to 16 faces of a reference image are found
+    std::vector<face_roi> faces(16);
+    int face_count = 0;
+    cv::Mat image;
 
     // Find all people in the directory
-    std::map<std::string, std::vector<float>> people;
+    // Gallery ids are indexes in the names list
+    std::vector<std::string> names;
+    std::vector<float> descriptor(descriptor_size);
+    face_gallery_handle* gallery = create_gallery(descriptor_size, NULL, NULL, 0);
+    if (!gallery) {
+        std::cout << receive_error() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
     for (const auto &entry : std::filesystem::directory_iterator("../data/people")) {
         // Get person image
         image = cv::imread(entry.path(), cv::IMREAD_COLOR);
 
         // Find faces
-        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-        cascade.detectMultiScale(gray, faces, 1.5, 5, 0, cv::Size(150, 150));
+        check(detector_detect(
+            detector,
+            image.rows, image.cols,
+            image.type(), image.step,
+            image.data,
+            faces.data(), int(faces.size()),
+            &face_count
+        ));
 
         // There must be one face per image
-        face_image = image(faces[0]);
+        if (!face_count) {
+            continue;
+        }
 
         // Get and save embedding for a face
-        // The library expects BGR image
-        cv::resize(face_image, face_image, cv::Size(160, 160));
-
-        // We have to manually allocate memory for the method
-        float* result = new float[SIZE_OF_IEFACENET_V1];
-        int result_size;
-        status = compute_embedding(
-            face_image.rows, face_image.cols,
-            face_image.type(), face_image.step,
-            face_image.data,
-            face_image.total() * face_image.elemSize(),
-            result, result_size
-        );
+        // The library expects BGR image and reads the face directly from it
+        check(classifier_embed_rois(
+            classifier,
+            image.rows, image.cols,
+            image.type(), image.step,
+            image.data,
+            faces.data(), 1,
+            descriptor.data(), descriptor_size
+        ));
+        check(gallery_add(gallery, (unsigned int)names.size(), descriptor.data()));
+        names.push_back(entry.path().filename());
+    }
 
-        if (status == EXIT_FAILURE) {
-            std::cout << receive_error() << std::endl;
-            std::exit(EXIT_FAILURE);
-        } else {
-            std::vector<float> reference(result, result + SIZE_OF_IEFACENET_V1);
-            people.insert(std::pair<std::string, std::vector<float>>(entry.path().filename(), reference));
-        }
+    // Detection, embedding and matching run in the pipeline threads
+    // The callback keeps the latest result, the main thread draws it on the frames it captures
+    LatestResult latest;
+    pipeline_handle* pipeline = create_pipeline(classifier, gallery, detector, NULL, store_result, &latest);
+    if (!pipeline) {
+        std::cout << receive_error() << std::endl;
+        std::exit(EXIT_FAILURE);
     }
 
-    // Now run webcam stream
+    // Frames come from a camera index, a video or an image directory given as the first argument,
+    // the second one is the replay rate of files (0 is as fast as possible)
+    FrameSource source(argc > 1 ? argv[1] : "0", argc > 2 ? std::stod(argv[2]) : 0.);
+    long long timestamp = 0;
     while (true) {
         std::chrono::high_resolution_clock::time_point t1 =
             std::chrono::high_resolution_clock::now();
 
-        // Get frame and detect faces
-        capture >> image;
-        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-        cascade.detectMultiScale(gray, faces, 1.5, 5, 0, cv::Size(150, 150));
-
-        for (cv::Rect &face : faces) {
-            // Get ROI
-            face_image = image(face);
-
-            // Get embedding
-            cv::resize(face_image, face_image, cv::Size(160, 160));
-
-            float* result = new float[SIZE_OF_IEFACENET_V1];
-            int result_size;
-            status = compute_embedding(
-                face_image.rows, face_image.cols,
-                face_image.type(), face_image.step,
-                face_image.data,
-                face_image.total() * face_image.elemSize(),
-                result, result_size
-            );
-
-            if (status == EXIT_FAILURE) {
-                std::cout << receive_error() << std::endl;
-                std::exit(EXIT_FAILURE);
+        if (!source.read(image)) {
+            break;
+        }
+
+        check(pipeline_push_frame(
+            pipeline,
+            image.rows, image.cols,
+            PIPELINE_FRAME_BGR, int(image.step),
+            image.data,
+            timestamp++,
+            NULL
+        ));
+
+        std::vector<pipeline_face> recognized;
+        {
+            std::lock_guard<std::mutex> lock(latest.mutex);
+            recognized = latest.faces;
+        }
+
+        for (const pipeline_face& result: recognized) {
+            const cv::Rect face(result.face.x, result.face.y, result.face.width, result.face.height);
+            cv::rectangle(image, face, cv::Scalar(255, 0, 255));
+
+            // Approximate threshold is applied by the pipeline
+            if (!result.identified) {
+                cv::putText(image, "unknown", cv::Point(face.tl()),
+                    cv::FONT_HERSHEY_COMPLEX_SMALL, 1.5, cv::Scalar(0, 0, 255));
             } else {
-                std::vector<float> result_v(result, result + SIZE_OF_IEFACENET_V1);
-                cv::rectangle(image, face, cv::Scalar(255, 0, 255));
-
-                // Find it's across saved people
-                float minDistance = 100;
-                std::string minKey;
-                for (const std::pair<std::string, std::vector<float>> &pair : people) {
-                    float distance;
-                    status = compute_distance(
-                        result_v.data(),
-                        pair.second.data(),
-                        result_v.size(),
-                        distance
-                    );
-
-                    if (status == EXIT_FAILURE) {
-                        std::cout << receive_error() << std::endl;
-                        std::exit(EXIT_FAILURE);
-                    } else {
-                        if (distance < minDistance) {
-                            minDistance = distance;
-                            minKey = pair.first;
-                        }
-                    }
-                }
-
-                // Approximate threshold
-                if (minDistance > 1) {
-                    cv::putText(image, "unknown", cv::Point(face.tl()),
-                        cv::FONT_HERSHEY_COMPLEX_SMALL, 1.5, cv::Scalar(0, 0, 255));
-                } else {
-                    std::string text =
-                        minKey + std::string(": ") + std::to_string(minDistance);
-                    cv::putText(image, text, cv::Point(face.tl()),
-                        cv::FONT_HERSHEY_COMPLEX_SMALL, 1.5, cv::Scalar(0, 0, 255));
-                }
+                std::string text =
+                    names[result.id] + std::string(": ") + std::to_string(result.distance);
+                cv::putText(image, text, cv::Point(face.tl()),
+                    cv::FONT_HERSHEY_COMPLEX_SMALL, 1.5, cv::Scalar(0, 0, 255));
             }
-
-            delete[] result;
         }
 
         // Compute FPS
@@ -157,7 +181,7 @@ int main() {
             std::chrono::high_resolution_clock::now();
         auto difference =
             std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
-        cv::putText(image, std::to_string(1000 / difference), cv::Point(50, 50),
+        cv::putText(image, std::to_string(1000 / std::max<long long>(difference, 1)), cv::Point(50, 50),
             cv::FONT_HERSHEY_COMPLEX_SMALL, 2.0, cv::Scalar(0, 255, 255)
         );
 
@@ -169,5 +193,21 @@ int main() {
         }
     }
 
-    release_ie_facenet_v1();
+    // Print how long every stage takes
+    pipeline_stage_statistics statistics[8];
+    int stage_count = 0;
+    check(pipeline_statistics(pipeline, statistics, 8, &stage_count));
+    for (int i = 0; i < std::min(stage_count, 8); i++) {
+        std::cout
+            << statistics[i].name << ": "
+            << statistics[i].average_ms << " ms average, "
+            << statistics[i].p95_ms << " ms p95, "
+            << statistics[i].max_ms << " ms max, "
+            << statistics[i].dropped << " dropped" << std::endl;
+    }
+
+    destroy_pipeline(pipeline);
+    destroy_gallery(gallery);
+    destroy_detector(detector);
+    destroy_classifier(classifier);
 }
@@ -5,47 +5,71 @@
     Year: 2019
 */
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <iostream>
-#include <memory>
 #include <map>
+#include <memory>
+#include <vector>
 
-#include <opencv2/objdetect/objdetect.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
-#include <opencv2/videoio/videoio.hpp>
 
 #include "classifier.hpp"
+#include "face_detector.hpp"
+#include "face_gallery.hpp"
+#include "face_tracker.hpp"
+#include "frame_source.hpp"
+#include "roi_face_detector.hpp"
+#include "staged_pipeline.hpp"
 
 
 // In this sample we use cpp interface
 int main(int argc, char* argv[]) {
-    cv::VideoCapture capture(0);
-        if (!capture.isOpened()) {
-        throw new std::runtime_error("Couldn't open a video stream");
-    }
-
     const cv::String keys =
         "{device         |MYRIAD| backend device (CPU, MYRIAD)}"
         "{xml            |<none>| path to model definition    }"
         "{bin            |<none>| path to model weights       }"
         "{detector       |<none>| path to face detector       }"
+        "{detector_type  |haar  | face detector (haar, ssd)   }"
+        "{detector_bin   |      | ssd detector weights        }"
         "{db             |<none>| path to reference people    }"
         "{width          |640   | stream width                }"
         "{height         |480   | stream height               }"
         "{flip           |false | flip stream images          }"
         "{GUI            |yes   | show gui                    }"
+        "{requests       |2     | number of infer requests    }"
+        "{queue          |2     | frames waiting for a stage  }"
+        "{cache          |      | compiled network cache dir  }"
+        "{refresh        |30    | frames between re-embeddings of a tracked face}"
+        "{input          |0     | camera index, video file or image directory}"
+        "{fps            |0     | replay rate of files, 0 is as fast as possible}"
+        "{detection_width|0     | frames are downscaled to this width for detection, 0 is full}"
+        "{roi_refresh    |0     | frames between full-frame detections, 0 disables ROI detection}"
+        "{benchmark      |      | process the whole input without drops and print throughput as JSON}"
     ;
     cv::CommandLineParser parser(argc, argv, keys);
     const std::string device = parser.get<std::string>("device");
     const std::string xml = parser.get<std::string>("xml");
     const std::string bin = parser.get<std::string>("bin");
     const std::string detector = parser.get<std::string>("detector");
+    const std::string detector_type = parser.get<std::string>("detector_type");
+    const std::string detector_bin = parser.get<std::string>("detector_bin");
     const std::string db = parser.get<std::string>("db");
     const std::string GUI = parser.get<std::string>("GUI");
     const bool flip = parser.get<bool>("flip");
     const int width = parser.get<int>("width");
     const int height = parser.get<int>("height");
+    const int requests = parser.get<int>("requests");
+    const int queue = parser.get<int>("queue");
+    const std::string cache = parser.get<std::string>("cache");
+    const int refresh = parser.get<int>("refresh");
+    const std::string input = parser.get<std::string>("input");
+    const double fps = parser.get<double>("fps");
+    const int detection_width = parser.get<int>("detection_width");
+    const int roi_refresh = parser.get<int>("roi_refresh");
+    const bool benchmark = parser.has("benchmark");
     if (!parser.check()) {
         parser.printErrors();
         return 0;
@@ -54,38 +78,53 @@ int main(int argc, char* argv[]) {
     std::cout << "Device: " << device << std::endl;
     std::cout << "XML: " << xml << std::endl;
     std::cout << "BIN: " << bin << std::endl;
-    std::cout << "Face detector: " << detector << std::endl;
+    std::cout << "Face detector: " << detector_type << " " << detector << std::endl;
     std::cout << "People: " << db << std::endl;
     std::cout << "Resolution: " << width << "x" << height << std::endl;
     std::cout << "GUI: " << GUI << std::endl;
+    std::cout << "Infer requests: " << requests << std::endl;
+    std::cout << "Network cache: " << cache << std::endl;
+    std::cout << "Track refresh: " << refresh << std::endl;
+    std::cout << "Input: " << input << " at " << fps << " FPS" << std::endl;
+    std::cout << "Detection width: " << detection_width << ", ROI refresh: " << roi_refresh << std::endl;
 
-    if (GUI == std::string("yes")) {
+    // Benchmark output is the only thing printed after the setup
+    const bool show = GUI == std::string("yes") && !benchmark;
+    if (show) {
         cv::namedWindow("frames");
     }
 
-    // Load face detector
-    cv::CascadeClassifier cascade;
-    cascade.load(detector);
+    ClassifierOptions options;
+    options.infer_requests = requests;
+    options.cache_dir = cache;
 
+    // Load face detector, the network one runs on the same device as the classifier
+    DetectorOptions detector_options;
+    detector_options.cache_dir = cache;
+    detector_options.detection_width = detection_width;
+    const std::shared_ptr<FaceDetector> face_detector = build_detector(
+        detector_type == std::string("ssd") ? DetectorType::IE_SSD : DetectorType::Haar_Cascade,
+        detector, detector_bin, device, detector_options);
     const std::shared_ptr<Classifier> classifier = build_classifier(
-        ClassifierType::IE_Facenet_V1, xml, bin, device);
+        ClassifierType::IE_Facenet_V1, xml, bin, device, options);
 
     std::vector<cv::Rect> faces;
 
-    capture.set(cv::CAP_PROP_FRAME_WIDTH, width);
-    capture.set(cv::CAP_PROP_FRAME_HEIGHT, height);
+    FrameSource source(input, fps);
+    source.set_resolution(width, height);
 
-    cv::Mat image, gray, face_image;
+    cv::Mat image, face_image;
 
     // Find all people in the directory
-    std::map<std::string, std::vector<float>> people;
+    // Gallery ids are indexes in the names list
+    std::vector<std::string> names;
+    FaceGallery gallery(SIZE_OF_IEFACENET_V1);
     for (const auto &entry: std::filesystem::directory_iterator(db.c_str())) {
         // Get person image
         image = cv::imread(entry.path(), cv::IMREAD_COLOR);
 
         // Find faces
-        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-        cascade.detectMultiScale(gray, faces, 1.5, 5, 0, cv::Size(150, 150));
+        face_detector->detect(image, faces);
 
         // There must be one face per image
         face_image = image(faces[0]);
@@ -100,23 +139,45 @@ int main(int argc, char* argv[]) {
         }
 
         std::cout << std::endl;
-        people.insert(std::pair<std::string, std::vector<float>>(entry.path().filename(), reference));
+        gallery.add(names.size(), reference);
+        names.push_back(entry.path().filename());
     }
 
-    // Now run webcam stream
-    while (true) {
-        std::chrono::high_resolution_clock::time_point t1 =
-            std::chrono::high_resolution_clock::now();
+    TrackerOptions tracker_options;
+    tracker_options.refresh_frames = refresh;
+    FaceTracker tracker(tracker_options);
+    std::atomic<size_t> embeddings(0);
+    size_t total_embeddings = 0;
+
+    // Capture, detection and recognition run in their own threads,
+    // the main thread only draws results, so throughput is limited by the slowest stage
+    // The benchmark processes every frame of the input, so its results are reproducible
+    StagedPipeline pipeline(queue, true, benchmark);
+    pipeline.set_source("capture", [&](FramePacket& packet) -> bool {
+        if (!source.read(packet.frame)) {
+            return false;
+        }
 
-        // Get frame and detect faces
-        capture >> image;
         if (flip) {
-            cv::flip(image, image, 0);
+            cv::flip(packet.frame, packet.frame, 0);
         }
 
-        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-        cascade.detectMultiScale(gray, faces, 1.5, 5, 0, cv::Size(150, 150));
+        return true;
+    });
+
+    // Stream frames may be searched only around known faces, rectangles are in full resolution anyway
+    std::shared_ptr<FaceDetector> stream_detector = face_detector;
+    if (roi_refresh > 0) {
+        RoiOptions roi_options;
+        roi_options.refresh_frames = size_t(roi_refresh);
+        stream_detector = std::make_shared<RoiFaceDetector>(face_detector, roi_options);
+    }
+
+    pipeline.add_stage("detect", [&](FramePacket& packet) -> bool {
+        stream_detector->detect(packet.frame, faces);
 
+        // Faces inside other faces are false detections
+        packet.faces.clear();
         for (cv::Rect &face : faces) {
             bool ignore = false;
             for (cv::Rect &another_face: faces) {
@@ -127,61 +188,162 @@ int main(int argc, char* argv[]) {
                     }
             }
 
-            if (ignore) {
+            if (!ignore) {
+                packet.faces.push_back(face);
+            }
+        }
+
+        return true;
+    });
+
+    // Only new, refreshed and grown faces are embedded, the others keep their identity
+    // The tracker and the identities are updated in one stage: a frame dropped between separate
+    // stages would lose an embedding the tracker won't request again until the next refresh
+    std::vector<cv::Mat> face_images;
+    // Identities of tracks, entries of tracks not seen for a while are removed
+    std::map<unsigned int, std::pair<RecognizedFace, uint64_t>> identities;
+    pipeline.add_stage("recognize", [&](FramePacket& packet) -> bool {
+        const std::vector<Track>& tracks = tracker.update(packet.faces);
+        packet.faces.clear();
+        packet.tracks.clear();
+        packet.embedded.clear();
+        face_images.clear();
+        for (const Track& track: tracks) {
+            if (track.missed) {
                 continue;
             }
-            // Get ROI
-            face_image = image(face);
-
-            // Get embedding
-            cv::resize(face_image, face_image, cv::Size(160, 160));
-            std::vector<float> result = classifier->embed(face_image);
-            cv::rectangle(image, face, cv::Scalar(255, 0, 255));
-
-            // Find it's across saved people
-            float minDistance = 100;
-            std::string minKey;
-            for (const std::pair<std::string, std::vector<float>> &pair : people) {
-                float distance = classifier->distance(pair.second, result);
-                if (distance < minDistance) {
-                    minDistance = distance;
-                    minKey = pair.first;
+
+            packet.faces.push_back(track.face);
+            packet.tracks.push_back(track.id);
+            packet.embedded.push_back(track.embed);
+            if (track.embed) {
+                face_images.push_back(packet.frame(track.face));
+            }
+        }
+
+        // Descriptors of embedded faces are packed in the face order
+        packet.descriptors.resize(face_images.size() * classifier->descriptor_size());
+        classifier->embed_batch(face_images.data(), face_images.size(), packet.descriptors.data());
+        embeddings += face_images.size();
+
+        packet.recognized.clear();
+        const float* descriptor = packet.descriptors.data();
+        for (size_t i = 0; i < packet.faces.size(); i++) {
+            auto& identity = identities[packet.tracks[i]];
+            if (packet.embedded[i]) {
+                // Find it's across saved people (approximate threshold)
+                GalleryMatch match = {0, 0.f};
+                const bool identified = gallery.search(descriptor, 1, 1.f, &match) > 0;
+                identity.first = {packet.faces[i], identified, match.id, match.distance};
+                descriptor += classifier->descriptor_size();
+
+                if (identified && GUI != std::string("yes") && !benchmark) {
+                    std::cout << "Found -> " << names[match.id] << ": " << match.distance
+                        << " (track " << packet.tracks[i] << ")" << std::endl;
                 }
             }
 
-            // Approximate threshold
-            if (minDistance > 1) {
-                cv::putText(image, "unknown", cv::Point(face.tl()),
+            identity.first.face = packet.faces[i];
+            identity.second = packet.index;
+            packet.recognized.push_back(identity.first);
+        }
+
+        for (auto it = identities.begin(); it != identities.end();) {
+            it = packet.index - it->second.second > 100 ? identities.erase(it) : std::next(it);
+        }
+
+        return true;
+    });
+
+    const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    pipeline.start();
+
+    // Now run the stream
+    FramePacket packet;
+    size_t frames = 0, total_frames = 0, total_faces = 0;
+    std::chrono::high_resolution_clock::time_point period_start = start;
+    while (pipeline.pop(packet)) {
+        total_frames++;
+        total_faces += packet.recognized.size();
+        if (benchmark) {
+            continue;
+        }
+
+        cv::Mat& frame = packet.frame;
+        for (const RecognizedFace& face: packet.recognized) {
+            cv::rectangle(frame, face.face, cv::Scalar(255, 0, 255));
+            if (!face.identified) {
+                cv::putText(frame, "unknown", cv::Point(face.face.tl()),
                     cv::FONT_HERSHEY_COMPLEX_SMALL, 1.5, cv::Scalar(0, 0, 255));
             } else {
                 std::string text =
-                    minKey + std::string(": ") + std::to_string(minDistance);
-                cv::putText(image, text, cv::Point(face.tl()),
+                    names[face.id] + std::string(": ") + std::to_string(face.distance);
+                cv::putText(frame, text, cv::Point(face.face.tl()),
                     cv::FONT_HERSHEY_COMPLEX_SMALL, 1.5, cv::Scalar(0, 0, 255));
-
-                if (GUI != std::string("yes")) {
-                    std::cout << "Found -> " << text << std::endl;
-                }
             }
         }
 
-        // Compute FPS
-        std::chrono::high_resolution_clock::time_point t2 =
+        // Compute FPS of processed frames and report how many inferences the tracker saves
+        frames++;
+        const std::chrono::high_resolution_clock::time_point now =
             std::chrono::high_resolution_clock::now();
-        auto difference =
-            std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
-        cv::putText(image, std::to_string(1000 / difference), cv::Point(50, 50),
-            cv::FONT_HERSHEY_COMPLEX_SMALL, 2.0, cv::Scalar(0, 255, 255)
-        );
-
-        if (GUI == std::string("yes")) {
-            imshow("frames", image);
-            const int waitKey = cv::waitKey(30);
+        const double elapsed = std::chrono::duration<double>(now - period_start).count();
+        if (elapsed >= 1.) {
+            const size_t period_embeddings = embeddings.exchange(0);
+            total_embeddings += period_embeddings;
+            std::cout
+                << "FPS: " << frames / elapsed
+                << ", embeddings per second: " << period_embeddings / elapsed << std::endl;
+            frames = 0;
+            period_start = now;
+        }
+
+        if (show) {
+            imshow("frames", frame);
+            const int waitKey = cv::waitKey(1);
             if (waitKey == 27) {
                 break;
             }
         }
     }
 
-    capture.release();
+    pipeline.stop();
+    const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    total_embeddings += embeddings.exchange(0);
+    if (benchmark) {
+        std::cout
+            << "{\"input\": \"" << input << "\", "
+            << "\"frames\": " << total_frames << ", "
+            << "\"faces\": " << total_faces << ", "
+            << "\"embeddings\": " << total_embeddings << ", "
+            << "\"dropped\": " << pipeline.dropped() << ", "
+            << "\"seconds\": " << seconds << ", "
+            << "\"fps\": " << total_frames / seconds << ", "
+            << "\"faces_per_second\": " << total_faces / seconds << ", "
+            << "\"stages\": [";
+        const std::vector<StageStatistics> stages = pipeline.statistics();
+        for (size_t i = 0; i < stages.size(); i++) {
+            std::cout
+                << (i ? ", " : "")
+                << "{\"name\": \"" << stages[i].name << "\", "
+                << "\"processed\": " << stages[i].processed << ", "
+                << "\"average_ms\": " << stages[i].average_ms << ", "
+                << "\"p50_ms\": " << stages[i].p50_ms << ", "
+                << "\"p95_ms\": " << stages[i].p95_ms << ", "
+                << "\"p99_ms\": " << stages[i].p99_ms << ", "
+                << "\"max_ms\": " << stages[i].max_ms << "}";
+        }
+        std::cout << "]}" << std::endl;
+        return 0;
+    }
+
+    for (const StageStatistics& stage: pipeline.statistics()) {
+        std::cout
+            << stage.name << ": "
+            << stage.average_ms << " ms average, "
+            << stage.p50_ms << "/" << stage.p95_ms << "/" << stage.p99_ms << " ms p50/p95/p99, "
+            << stage.max_ms << " ms max, "
+            << stage.processed << " processed, "
+            << stage.dropped << " dropped" << std::endl;
+    }
 }
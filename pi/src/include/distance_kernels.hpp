@@ -0,0 +1,69 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#ifndef DISTANCE_KERNELS_HPP
+#define DISTANCE_KERNELS_HPP
+
+#include <cstddef>
+
+#include "macros_defs.h"
+
+// Supported descriptor comparisons
+enum DistanceMetric {
+    // Cosine of the angle between descriptors, 0 if any of them is zero
+    Cosine_Similarity,
+    // Sum of squared differences
+    Squared_L2_Distance,
+    // Plain dot product, it is cosine similarity for L2-normalized descriptors
+    Dot_Product,
+};
+
+typedef float (*DistanceKernel)(const float* first, const float* second, size_t size);
+
+// Returns the fastest kernel for this CPU
+// Kernels are specialized for 128 and SIZE_OF_IEFACENET_V1 dimensions, other sizes use a generic loop
+// The size argument of a specialized kernel is ignored
+API DistanceKernel distance_kernel(DistanceMetric metric, size_t dimension);
+
+// Returns name of the instruction set used by distance_kernel()
+API const char* distance_kernel_isa();
+
+// Kernels for every instruction set, each of them is built with its own compiler flags
+// and must be called only if the CPU supports the instruction set
+// Code in those files must have internal linkage, otherwise the linker may pick
+// an instantiation with unsupported instructions for other translation units
+DistanceKernel scalar_distance_kernel(DistanceMetric metric, size_t dimension);
+#if defined(__x86_64__) || defined(__i386__)
+DistanceKernel sse4_distance_kernel(DistanceMetric metric, size_t dimension);
+DistanceKernel avx2_distance_kernel(DistanceMetric metric, size_t dimension);
+DistanceKernel avx512_distance_kernel(DistanceMetric metric, size_t dimension);
+#elif defined(__arm__) || defined(__aarch64__)
+DistanceKernel neon_distance_kernel(DistanceMetric metric, size_t dimension);
+#endif
+
+// Instantiates kernels of an instruction set for the specialized dimensions
+// Kernel templates take the dimension as the first parameter, 0 means the size argument is used
+#define DISTANCE_KERNEL_SELECTOR(isa, cosine, squared_l2, dot)                      \
+    template <size_t Dimension>                                                     \
+    static DistanceKernel isa##_select(DistanceMetric metric) {                     \
+        switch (metric) {                                                           \
+            case DistanceMetric::Cosine_Similarity: return &cosine<Dimension>;      \
+            case DistanceMetric::Squared_L2_Distance: return &squared_l2<Dimension>;\
+            case DistanceMetric::Dot_Product: return &dot<Dimension>;               \
+        }                                                                           \
+        return nullptr;                                                             \
+    }                                                                               \
+                                                                                    \
+    DistanceKernel isa##_distance_kernel(DistanceMetric metric, size_t dimension) { \
+        switch (dimension) {                                                        \
+            case 128: return isa##_select<128>(metric);                             \
+            case SIZE_OF_IEFACENET_V1: return isa##_select<SIZE_OF_IEFACENET_V1>(metric); \
+            default: return isa##_select<0>(metric);                                \
+        }                                                                           \
+    }
+
+#endif
@@ -0,0 +1,27 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#ifndef HAAR_FACE_DETECTOR_HPP
+#define HAAR_FACE_DETECTOR_HPP
+
+#include <mutex>
+#include <opencv2/objdetect/objdetect.hpp>
+
+#include "face_detector.hpp"
+
+class HaarFaceDetector: public FaceDetector {
+    private:
+        // Cascade isn't thread-safe, calls are serialized
+        cv::CascadeClassifier _cascade;
+        std::mutex _mutex;
+        DetectorOptions _options;
+    public:
+        HaarFaceDetector(const std::string cascade, const DetectorOptions& options = DetectorOptions());
+        void detect(const cv::Mat& frame, std::vector<cv::Rect>& faces) override;
+};
+
+#endif
@@ -0,0 +1,85 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#ifndef IE_COMMON_HPP
+#define IE_COMMON_HPP
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+#include <inference_engine.hpp>
+
+// Returns the inference engine core shared by all networks of the library
+// Devices are opened once, the core lives while somebody holds it
+std::shared_ptr<InferenceEngine::Core> shared_core();
+
+// Imports the network from the compiled network cache or compiles it with load()
+// Compiled network is stored into the cache, an empty cache_dir disables the cache
+// Configuration must describe everything load() changes in the network
+InferenceEngine::ExecutableNetwork load_cached_network(
+    InferenceEngine::Core& ie,
+    const std::string& cache_dir,
+    const std::string& name,
+    const std::string& xml,
+    const std::string& bin,
+    const std::string& device,
+    const std::map<std::string, std::string>& config,
+    const std::string& configuration,
+    const std::function<InferenceEngine::ExecutableNetwork()>& load
+);
+
+// Infer request with its own blobs, it is used by one call at a time
+struct InferContext {
+    InferenceEngine::InferRequest request;
+    InferenceEngine::Blob::Ptr input;
+    InferenceEngine::Blob::Ptr output;
+    size_t batch_size;
+    // Called by the inference engine when an asynchronous request is finished
+    std::function<void(InferContext*, InferenceEngine::StatusCode)> completion;
+};
+
+// Infer requests of one executable network shared by all calls
+// Number of requests limits how many inferences run simultaneously
+class InferRequestPool {
+    private:
+        std::vector<std::unique_ptr<InferContext>> _contexts;
+        std::vector<InferContext*> _idle_contexts;
+        std::mutex _idle_mutex;
+        std::condition_variable _idle_condition;
+    public:
+        // Returns a context into the pool when a synchronous call is finished
+        class Guard {
+            private:
+                InferRequestPool* _pool;
+                InferContext* _context;
+            public:
+                explicit Guard(InferRequestPool* pool);
+                Guard(const Guard&) = delete;
+                Guard& operator=(const Guard&) = delete;
+                InferContext* get() const;
+                InferContext* operator->() const;
+                ~Guard();
+        };
+
+        InferRequestPool(InferenceEngine::ExecutableNetwork& executable, size_t size, size_t batch_size);
+        InferRequestPool(const InferRequestPool&) = delete;
+        InferRequestPool& operator=(const InferRequestPool&) = delete;
+
+        // Waits for an idle context
+        InferContext* acquire();
+        void release(InferContext* context);
+
+        // Waits for running asynchronous requests
+        ~InferRequestPool();
+};
+
+#endif
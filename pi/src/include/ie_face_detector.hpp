@@ -0,0 +1,33 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#ifndef IE_FACE_DETECTOR_HPP
+#define IE_FACE_DETECTOR_HPP
+
+#include "face_detector.hpp"
+#include "ie_common.hpp"
+
+// SSD face detector, the network output is [1, 1, N, 7] detections
+// of [image_id, label, confidence, x_min, y_min, x_max, y_max] in relative coordinates
+class IEFaceDetector: public FaceDetector {
+    private:
+        std::shared_ptr<InferenceEngine::Core> _core;
+        InferenceEngine::ExecutableNetwork _executable;
+        DetectorOptions _options;
+        std::unique_ptr<InferRequestPool> _pool;
+    public:
+        IEFaceDetector(
+            const std::string xml,
+            const std::string bin,
+            const std::string device,
+            const DetectorOptions& options = DetectorOptions()
+        );
+        void detect(const cv::Mat& frame, std::vector<cv::Rect>& faces) override;
+        ~IEFaceDetector();
+};
+
+#endif
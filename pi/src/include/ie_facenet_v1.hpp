@@ -8,20 +8,54 @@
 #ifndef IE_FACENET_V1
 #define IE_FACENET_V1
 
+#include <map>
+
 #include "classifier.hpp"
-#include <inference_engine.hpp>
+#include "distance_kernels.hpp"
+#include "ie_common.hpp"
 
 class IEFacenet_V1: public Classifier {
     private:
+        std::shared_ptr<InferenceEngine::Core> _core;
         InferenceEngine::ExecutableNetwork _executable;
-        InferenceEngine::CNNNetwork _network;
-        InferenceEngine::InferRequest _infer_request;
-        InferenceEngine::Blob::Ptr _input;
-        InferenceEngine::Blob::Ptr _output;
+        size_t _max_batch_size;
+        size_t _descriptor_size;
+        DistanceKernel _cosine;
+        DistanceKernel _dot;
+        bool _dynamic_batch;
+        PreprocessingType _preprocessing;
+        std::unique_ptr<InferRequestPool> _pool;
+
+        InferenceEngine::ExecutableNetwork load_network(
+            const std::string& xml,
+            const std::string& bin,
+            const std::string& device,
+            const std::map<std::string, std::string>& config
+        );
+        void preprocess(const cv::Mat& face, const InferenceEngine::Blob::Ptr& input, size_t id) const;
+        void set_batch_size(InferContext* context, size_t batch_size) const;
     public:
-        IEFacenet_V1(const std::string xml, const std::string bin, const std::string device);
+        IEFacenet_V1(
+            const std::string xml,
+            const std::string bin,
+            const std::string device,
+            const ClassifierOptions& options = ClassifierOptions()
+        );
         float distance(const FaceDescriptor& desc1, const FaceDescriptor& desc2) override;
+        void distance_matrix(
+            const float* first,
+            size_t first_count,
+            const float* second,
+            size_t second_count,
+            size_t size,
+            float* result
+        ) override;
         FaceDescriptor embed(const cv::Mat& face) override;
+        std::vector<FaceDescriptor> embed_batch(const std::vector<cv::Mat>& faces) override;
+        void embed_batch(const cv::Mat* faces, size_t count, float* descriptors) override;
+        size_t descriptor_size() const override;
+        std::future<FaceDescriptor> embed_async(const cv::Mat& face) override;
+        PreprocessingType preprocessing() const;
         ~IEFacenet_V1();
 };
 
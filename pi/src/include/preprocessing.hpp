@@ -0,0 +1,19 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#ifndef PREPROCESSING_HPP
+#define PREPROCESSING_HPP
+
+#include <opencv2/core/mat.hpp>
+
+#include "macros_defs.h"
+
+// Converts interleaved BGR U8 image into planar RGB floats normalized as (x - 127.5) / 128
+// It is a single pass over the image, destination must have space for 3 * image.total() floats
+API void bgr_to_planar_rgb(const cv::Mat& image, float* destination);
+
+#endif
@@ -0,0 +1,183 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#ifndef RING_BUFFER_HPP
+#define RING_BUFFER_HPP
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <condition_variable>
+
+// Lock-free bounded queue between two pipeline stages, one thread pushes and one thread pops
+// A full queue drops its oldest item, so the consumer always gets the freshest data
+// Every cell has a sequence number which tells whose turn it is (the bounded queue of D. Vyukov),
+// it lets the producer take the oldest item away without racing with the consumer
+// An idle consumer sleeps on a condition variable, the producer touches the mutex only if somebody sleeps
+template <typename T>
+class RingBuffer {
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T item;
+        };
+
+        std::unique_ptr<Cell[]> _cells;
+        size_t _capacity;
+        // Producer and consumer positions live in different cache lines
+        alignas(64) std::atomic<size_t> _head;
+        alignas(64) std::atomic<size_t> _tail;
+        std::atomic<bool> _closed;
+        // Consumers which are going to sleep or sleep in pop()
+        std::atomic<size_t> _waiters;
+        std::mutex _mutex;
+        std::condition_variable _ready;
+
+        // Short waits are spent spinning, it is cheaper than sleeping when items come quickly
+        static const size_t SPIN_ATTEMPTS = 64;
+
+        // Called after an item is published or the queue is closed
+        // The fences pair with the ones in pop(): either the consumer sees the item or the producer sees the waiter,
+        // and the waiter checks the queue under the mutex, so the notification can't come before it sleeps
+        void wake() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (this->_waiters.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(this->_mutex);
+                this->_ready.notify_all();
+            }
+        }
+
+        // Takes the oldest item, it is called by the consumer and by the producer dropping items
+        bool take(T& item) {
+            size_t position = this->_tail.load(std::memory_order_relaxed);
+            while (true) {
+                Cell& cell = this->_cells[position % this->_capacity];
+                const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                if (sequence == position + 1) {
+                    if (this->_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        item = std::move(cell.item);
+                        cell.sequence.store(position + this->_capacity, std::memory_order_release);
+                        return true;
+                    }
+                } else if (sequence < position + 1) {
+                    return false;
+                } else {
+                    position = this->_tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+    public:
+        explicit RingBuffer(size_t capacity)
+            : _cells(new Cell[capacity ? capacity : 1])
+            , _capacity(capacity ? capacity : 1)
+            , _head(0)
+            , _tail(0)
+            , _closed(false)
+            , _waiters(0) {
+            for (size_t i = 0; i < this->_capacity; i++) {
+                this->_cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        RingBuffer(const RingBuffer&) = delete;
+        RingBuffer& operator=(const RingBuffer&) = delete;
+
+        // Never blocks, returns false if the oldest item was dropped to make room
+        bool push(T item) {
+            bool dropped = false;
+            const size_t position = this->_head.load(std::memory_order_relaxed);
+            Cell& cell = this->_cells[position % this->_capacity];
+            while (cell.sequence.load(std::memory_order_acquire) != position) {
+                // The queue is full, or the consumer is still moving the item out of the cell
+                T oldest;
+                if (position - this->_tail.load(std::memory_order_relaxed) >= this->_capacity && this->take(oldest)) {
+                    dropped = true;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+
+            cell.item = std::move(item);
+            cell.sequence.store(position + 1, std::memory_order_release);
+            this->_head.store(position + 1, std::memory_order_relaxed);
+            this->wake();
+            return !dropped;
+        }
+
+        // Never drops, returns false and keeps the item if the queue is full
+        bool try_push(T& item) {
+            const size_t position = this->_head.load(std::memory_order_relaxed);
+            Cell& cell = this->_cells[position % this->_capacity];
+            if (cell.sequence.load(std::memory_order_acquire) != position) {
+                return false;
+            }
+
+            cell.item = std::move(item);
+            cell.sequence.store(position + 1, std::memory_order_release);
+            this->_head.store(position + 1, std::memory_order_relaxed);
+            this->wake();
+            return true;
+        }
+
+        // Returns false immediately if the queue is empty
+        bool try_pop(T& item) {
+            return this->take(item);
+        }
+
+        // Waits for an item, returns false if the queue is closed and empty
+        bool pop(T& item) {
+            for (size_t attempt = 0; attempt < SPIN_ATTEMPTS; attempt++) {
+                if (this->take(item)) {
+                    return true;
+                }
+
+                // The last item may have been pushed just before close()
+                if (this->_closed.load(std::memory_order_acquire)) {
+                    return this->take(item);
+                }
+
+                std::this_thread::yield();
+            }
+
+            this->_waiters.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool taken = false;
+            {
+                std::unique_lock<std::mutex> lock(this->_mutex);
+                this->_ready.wait(lock, [this, &item, &taken]() {
+                    taken = this->take(item);
+                    return taken || this->_closed.load(std::memory_order_acquire);
+                });
+            }
+            this->_waiters.fetch_sub(1, std::memory_order_relaxed);
+
+            return taken || this->take(item);
+        }
+
+        // Wakes the consumer up, it gets the remaining items and then pop() returns false
+        void close() {
+            this->_closed.store(true, std::memory_order_release);
+            this->wake();
+        }
+
+        size_t capacity() const {
+            return this->_capacity;
+        }
+
+        // Pause of a producer waiting for room in the queue, short waits are spent spinning, long ones sleeping
+        static void backoff(size_t attempt) {
+            if (attempt < SPIN_ATTEMPTS) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+};
+
+#endif
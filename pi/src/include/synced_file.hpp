@@ -0,0 +1,46 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#ifndef SYNCED_FILE_HPP
+#define SYNCED_FILE_HPP
+
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+// Error with the path and the description of errno
+std::runtime_error system_error(const std::string& message, const std::string& path);
+
+// File written with plain POSIX calls, so the data can be synced to the storage
+// Writes are retried until everything is written, failures throw std::runtime_error
+class SyncedFile {
+    private:
+        int _descriptor;
+        uint64_t _offset;
+        std::string _path;
+    public:
+        // Opens the file for writing at its end, flags are added to O_WRONLY | O_CREAT (e.g. O_TRUNC)
+        SyncedFile(const std::string& path, int flags);
+        SyncedFile(const SyncedFile&) = delete;
+        SyncedFile& operator=(const SyncedFile&) = delete;
+
+        void write(const void* data, size_t size);
+        // Writes zeros up to the offset
+        void pad(uint64_t offset);
+        // Cuts the file at the offset, the next write starts there
+        void truncate(uint64_t offset);
+        // Returns when the written data is on the storage
+        void sync();
+        uint64_t offset() const;
+
+        ~SyncedFile();
+};
+
+// Syncs the directory of the path, so a file created or renamed there survives a power loss
+void sync_directory(const std::string& path);
+
+#endif
@@ -6,44 +6,738 @@
 */
 
 #include <memory>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <shared_mutex>
 
 #include "cwrapper.h"
 #include "classifier.hpp"
+#include "face_detector.hpp"
+#include "face_gallery.hpp"
+#include "recognition_pipeline.hpp"
 
-std::shared_ptr<Classifier> classifier;
-const char* exception_message = NULL;
+struct classifier_handle {
+    std::shared_ptr<Classifier> classifier;
+};
+
+// FaceGallery isn't thread-safe, the lock lets searches run in parallel
+struct face_gallery_handle {
+    FaceGallery gallery;
+    std::shared_mutex mutex;
+
+    explicit face_gallery_handle(size_t dimension): gallery(dimension) {}
+};
+
+struct face_detector_handle {
+    std::shared_ptr<FaceDetector> detector;
+};
+
+struct pipeline_handle {
+    std::unique_ptr<RecognitionPipeline> pipeline;
+};
+
+static_assert(sizeof(gallery_match) == sizeof(GalleryMatch), "gallery_match must match GalleryMatch");
+
+// Every thread has its own error, so concurrent calls don't overwrite messages of each other
+static thread_local std::string last_error;
+static thread_local std::string received_error;
+static thread_local bool has_error = false;
+
+// The classifier used by the compatibility functions
+// It is replaced atomically, so a running call keeps its own reference
+static std::shared_ptr<Classifier> global_classifier;
+
+static void set_error(const char* message) {
+    last_error = message;
+    has_error = true;
+}
+
+static ClassifierOptions to_classifier_options(const classifier_options* options) {
+    ClassifierOptions result;
+    if (!options) {
+        return result;
+    }
+
+    result.max_batch_size = size_t(std::max(options->max_batch_size, 1));
+    result.infer_requests = size_t(std::max(options->infer_requests, 1));
+    result.preprocessing = options->host_preprocessing ?
+        PreprocessingType::Host_Preprocessing : PreprocessingType::Engine_Preprocessing;
+    result.cache_dir = options->cache_dir ? options->cache_dir : "";
+    result.cpu_streams = options->cpu_streams;
+    result.cpu_threads = options->cpu_threads;
+    result.cpu_bind_thread = options->cpu_bind_thread != 0;
+    return result;
+}
+
+static std::shared_ptr<Classifier> checked_classifier(const classifier_handle* handle) {
+    if (!handle || !handle->classifier) {
+        throw std::invalid_argument("Classifier handle is NULL");
+    }
+
+    return handle->classifier;
+}
+
+static face_gallery_handle& checked_gallery(face_gallery_handle* handle) {
+    if (!handle) {
+        throw std::invalid_argument("Gallery handle is NULL");
+    }
+
+    return *handle;
+}
+
+static std::shared_ptr<FaceDetector> checked_detector(const face_detector_handle* handle) {
+    if (!handle || !handle->detector) {
+        throw std::invalid_argument("Detector handle is NULL");
+    }
+
+    return handle->detector;
+}
+
+static std::shared_ptr<Classifier> checked_global_classifier() {
+    std::shared_ptr<Classifier> classifier = std::atomic_load(&global_classifier);
+    if (!classifier) {
+        throw std::runtime_error("Classifier hasn't been initialized yet");
+    }
+
+    return classifier;
+}
+
+static void embed(
+    Classifier& classifier,
+    const int height,
+    const int width,
+    const int type,
+    const int step,
+    const unsigned char* data,
+    float* result,
+    const size_t result_capacity,
+    int& result_size
+) {
+    if (!data || !result) {
+        throw std::invalid_argument("Image and result must not be NULL");
+    }
+
+    const cv::Mat face(height, width, type, (void*)data, step);
+    const FaceDescriptor desc = classifier.embed(face);
+    if (desc.size() > result_capacity) {
+        throw std::length_error("Result buffer is too small for the descriptor");
+    }
+
+    memcpy(result, desc.data(), sizeof(float) * desc.size());
+    result_size = int(desc.size());
+}
+
+static float distance(Classifier& classifier, const float* first, const float* second, const int size) {
+    if (!first || !second || size < 0) {
+        throw std::invalid_argument("Descriptors must not be NULL");
+    }
+
+    // One element matrix reads the caller arrays in place
+    float result = 0;
+    classifier.distance_matrix(first, 1, second, 1, size_t(size), &result);
+    return result;
+}
 
 EXTERN_C
     const char* receive_error() {
-        const char* tmp = exception_message;
-        exception_message = NULL;
-        return tmp;
+        if (!has_error) {
+            return NULL;
+        }
+
+        has_error = false;
+        received_error.swap(last_error);
+        return received_error.c_str();
     }
 
-    int init_ie_facenet_v1(const char* xml, const char* bin, const char* device) {
+    void default_classifier_options(classifier_options* options) {
+        const ClassifierOptions defaults;
+        options->max_batch_size = defaults.max_batch_size;
+        options->infer_requests = defaults.infer_requests;
+        options->host_preprocessing = defaults.preprocessing == PreprocessingType::Host_Preprocessing;
+        options->cache_dir = NULL;
+        options->cpu_streams = defaults.cpu_streams;
+        options->cpu_threads = defaults.cpu_threads;
+        options->cpu_bind_thread = defaults.cpu_bind_thread;
+    }
+
+    classifier_handle* create_classifier(
+        const char* xml,
+        const char* bin,
+        const char* device,
+        const classifier_options* options
+    ) {
         // Do not pass any exceptions in C written application
         try {
-            if (classifier) {
-                throw new std::runtime_error("Classifier has already been initialized");
+            if (!xml || !bin || !device) {
+                throw std::invalid_argument("Model paths and device must not be NULL");
+            }
+
+            std::unique_ptr<classifier_handle> handle(new classifier_handle());
+            handle->classifier = build_classifier(
+                ClassifierType::IE_Facenet_V1,
+                std::string(xml),
+                std::string(bin),
+                std::string(device),
+                to_classifier_options(options)
+            );
+            return handle.release();
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return NULL;
+        }
+    }
+
+    void destroy_classifier(classifier_handle* handle) {
+        try {
+            delete handle;
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+        }
+    }
+
+    int classifier_embed(
+        classifier_handle* handle,
+        const int height,
+        const int width,
+        const int type,
+        const int step,
+        const unsigned char* data,
+        float* result,
+        const int result_capacity,
+        int* result_size
+    ) {
+        try {
+            if (!result_size || result_capacity < 0) {
+                throw std::invalid_argument("Result size must not be NULL");
             }
 
-            classifier = build_classifier(ClassifierType::IE_Facenet_V1, std::string(xml), std::string(bin), std::string(device));
+            embed(*checked_classifier(handle), height, width, type, step, data,
+                result, size_t(result_capacity), *result_size);
         } catch(const std::exception& exception) {
-            exception_message = exception.what();
+            set_error(exception.what());
             return EXIT_FAILURE;
         }
 
         return EXIT_SUCCESS;
     }
 
-    int release_ie_facenet_v1() {
-        if (classifier) {
-            try {
-                classifier.reset();
-            } catch(const std::exception& exception) {
-                exception_message = exception.what();
-                return EXIT_FAILURE;
+    int classifier_distance(
+        classifier_handle* handle,
+        const float* first,
+        const float* second,
+        const int size,
+        float* result
+    ) {
+        try {
+            if (!result) {
+                throw std::invalid_argument("Result must not be NULL");
+            }
+
+            *result = distance(*checked_classifier(handle), first, second, size);
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int classifier_descriptor_size(classifier_handle* handle, int* size) {
+        try {
+            if (!size) {
+                throw std::invalid_argument("Size must not be NULL");
             }
+
+            *size = int(checked_classifier(handle)->descriptor_size());
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int classifier_embed_rois(
+        classifier_handle* handle,
+        const int height,
+        const int width,
+        const int type,
+        const int step,
+        const unsigned char* data,
+        const face_roi* rois,
+        const int count,
+        float* result,
+        const int result_capacity
+    ) {
+        try {
+            const std::shared_ptr<Classifier> classifier = checked_classifier(handle);
+            if (count < 0 || (count && (!data || !rois || !result))) {
+                throw std::invalid_argument("Frame, faces and result must not be NULL");
+            }
+
+            if (size_t(count) * classifier->descriptor_size() > size_t(std::max(result_capacity, 0))) {
+                throw std::length_error("Result buffer is too small for the descriptors");
+            }
+
+            // ROI headers point into the frame, the vector is reused by next calls in the same thread
+            static thread_local std::vector<cv::Mat> faces;
+            const cv::Mat frame(height, width, type, (void*)data, step);
+            const cv::Rect bounds(0, 0, width, height);
+            faces.resize(count);
+            for (int i = 0; i < count; i++) {
+                const cv::Rect roi(rois[i].x, rois[i].y, rois[i].width, rois[i].height);
+                if (roi.empty() || (roi & bounds) != roi) {
+                    throw std::out_of_range("Face rectangle is out of the frame");
+                }
+
+                faces[i] = frame(roi);
+            }
+
+            classifier->embed_batch(faces.data(), size_t(count), result);
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int classifier_distance_matrix(
+        classifier_handle* handle,
+        const float* first,
+        const int first_count,
+        const float* second,
+        const int second_count,
+        const int size,
+        float* result
+    ) {
+        try {
+            const std::shared_ptr<Classifier> classifier = checked_classifier(handle);
+            if (first_count < 0 || second_count < 0 || size < 0) {
+                throw std::invalid_argument("Counts and size must not be negative");
+            }
+
+            if ((first_count && !first) || (second_count && !second) || (first_count && second_count && !result)) {
+                throw std::invalid_argument("Descriptors and result must not be NULL");
+            }
+
+            classifier->distance_matrix(
+                first, size_t(first_count), second, size_t(second_count), size_t(size), result);
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    face_gallery_handle* create_gallery(
+        const int dimension,
+        const unsigned int* ids,
+        const float* descriptors,
+        const int count
+    ) {
+        try {
+            if (dimension <= 0 || count < 0 || (count && (!ids || !descriptors))) {
+                throw std::invalid_argument("Gallery dimension must be positive, ids and descriptors must not be NULL");
+            }
+
+            std::unique_ptr<face_gallery_handle> handle(new face_gallery_handle(size_t(dimension)));
+            handle->gallery.add(ids, descriptors, size_t(count));
+            return handle.release();
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return NULL;
+        }
+    }
+
+    void destroy_gallery(face_gallery_handle* handle) {
+        delete handle;
+    }
+
+    int gallery_add(face_gallery_handle* handle, const unsigned int id, const float* descriptor) {
+        try {
+            face_gallery_handle& gallery = checked_gallery(handle);
+            if (!descriptor) {
+                throw std::invalid_argument("Descriptor must not be NULL");
+            }
+
+            std::unique_lock<std::shared_mutex> lock(gallery.mutex);
+            gallery.gallery.add(id, descriptor);
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int gallery_remove(face_gallery_handle* handle, const unsigned int id, int* removed) {
+        try {
+            face_gallery_handle& gallery = checked_gallery(handle);
+            std::unique_lock<std::shared_mutex> lock(gallery.mutex);
+            const bool result = gallery.gallery.remove(id);
+            if (removed) {
+                *removed = result;
+            }
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int gallery_size(face_gallery_handle* handle, int* size) {
+        try {
+            face_gallery_handle& gallery = checked_gallery(handle);
+            if (!size) {
+                throw std::invalid_argument("Size must not be NULL");
+            }
+
+            std::shared_lock<std::shared_mutex> lock(gallery.mutex);
+            *size = int(gallery.gallery.size());
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int gallery_search(
+        face_gallery_handle* handle,
+        const float* probe,
+        const int k,
+        const float threshold,
+        gallery_match* matches,
+        int* match_count
+    ) {
+        try {
+            face_gallery_handle& gallery = checked_gallery(handle);
+            if (!probe || !match_count || k < 0 || (k && !matches)) {
+                throw std::invalid_argument("Probe, matches and match count must not be NULL");
+            }
+
+            // Matches are written in place, both structures have the same layout
+            std::shared_lock<std::shared_mutex> lock(gallery.mutex);
+            *match_count = int(gallery.gallery.search(
+                probe, size_t(k), threshold, reinterpret_cast<GalleryMatch*>(matches)));
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    void default_detector_options(detector_options* options) {
+        const DetectorOptions defaults;
+        options->min_face_size = defaults.min_face_size.width;
+        options->scale_factor = float(defaults.scale_factor);
+        options->min_neighbors = defaults.min_neighbors;
+        options->detection_width = defaults.detection_width;
+        options->confidence = defaults.confidence;
+        options->infer_requests = int(defaults.infer_requests);
+        options->cache_dir = NULL;
+    }
+
+    face_detector_handle* create_detector(
+        const int type,
+        const char* model,
+        const char* weights,
+        const char* device,
+        const detector_options* options
+    ) {
+        try {
+            if (!model) {
+                throw std::invalid_argument("Model must not be NULL");
+            }
+
+            DetectorType detector_type = DetectorType::Haar_Cascade;
+            switch (type) {
+                case DETECTOR_HAAR_CASCADE:
+                    break;
+                case DETECTOR_IE_SSD:
+                    if (!weights || !device) {
+                        throw std::invalid_argument("Weights and device must not be NULL");
+                    }
+                    detector_type = DetectorType::IE_SSD;
+                    break;
+                default:
+                    throw std::invalid_argument("Unknown detector type");
+            }
+
+            DetectorOptions detector_options;
+            if (options) {
+                detector_options.min_face_size = cv::Size(options->min_face_size, options->min_face_size);
+                detector_options.scale_factor = options->scale_factor;
+                detector_options.min_neighbors = options->min_neighbors;
+                detector_options.detection_width = std::max(options->detection_width, 0);
+                detector_options.confidence = options->confidence;
+                detector_options.infer_requests = size_t(std::max(options->infer_requests, 1));
+                detector_options.cache_dir = options->cache_dir ? options->cache_dir : "";
+            }
+
+            std::unique_ptr<face_detector_handle> handle(new face_detector_handle());
+            handle->detector = build_detector(
+                detector_type,
+                model,
+                weights ? weights : "",
+                device ? device : "",
+                detector_options
+            );
+            return handle.release();
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return NULL;
+        }
+    }
+
+    void destroy_detector(face_detector_handle* handle) {
+        delete handle;
+    }
+
+    int detector_detect(
+        face_detector_handle* handle,
+        const int height,
+        const int width,
+        const int type,
+        const int step,
+        const unsigned char* data,
+        face_roi* faces,
+        const int capacity,
+        int* face_count
+    ) {
+        try {
+            if (!data || !face_count || capacity < 0 || (capacity && !faces)) {
+                throw std::invalid_argument("Image, faces and face count must not be NULL");
+            }
+
+            // The buffer is reused by next calls in the same thread
+            static thread_local std::vector<cv::Rect> found;
+            const cv::Mat image(height, width, type, (void*)data, step);
+            checked_detector(handle)->detect(image, found);
+
+            for (size_t i = 0; i < std::min(found.size(), size_t(capacity)); i++) {
+                faces[i] = {found[i].x, found[i].y, found[i].width, found[i].height};
+            }
+            *face_count = int(found.size());
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    void default_pipeline_options(pipeline_options* options) {
+        const PipelineOptions defaults;
+        options->queue_size = int(defaults.queue_size);
+        options->threshold = defaults.threshold;
+        options->roi_refresh_frames = int(defaults.roi_refresh_frames);
+    }
+
+    pipeline_handle* create_pipeline(
+        classifier_handle* classifier,
+        face_gallery_handle* gallery,
+        face_detector_handle* detector,
+        const pipeline_options* options,
+        pipeline_callback callback,
+        void* user_data
+    ) {
+        try {
+            // The matcher searches descriptors of the classifier, the gallery dimension never changes
+            if (checked_gallery(gallery).gallery.dimension() != checked_classifier(classifier)->descriptor_size()) {
+                throw std::invalid_argument("Gallery dimension doesn't match the classifier descriptor size");
+            }
+
+            if (!callback) {
+                throw std::invalid_argument("Callback must not be NULL");
+            }
+
+            PipelineOptions pipeline_options;
+            if (options) {
+                pipeline_options.queue_size = size_t(std::max(options->queue_size, 1));
+                pipeline_options.threshold = options->threshold;
+                pipeline_options.roi_refresh_frames = size_t(std::max(options->roi_refresh_frames, 0));
+            }
+
+            const FaceMatcher matcher = [gallery](const float* descriptor, float threshold, GalleryMatch& match) {
+                std::shared_lock<std::shared_mutex> lock(gallery->mutex);
+                return gallery->gallery.search(descriptor, 1, threshold, &match) > 0;
+            };
+
+            // The result buffer lives in the matching thread and is reused for every frame
+            const RecognitionCallback recognition_callback = [callback, user_data](const RecognitionResult& result) {
+                static thread_local std::vector<pipeline_face> faces;
+                faces.clear();
+                for (const RecognizedFace& face: result.faces) {
+                    faces.push_back({
+                        {face.face.x, face.face.y, face.face.width, face.face.height},
+                        face.identified,
+                        face.id,
+                        face.distance
+                    });
+                }
+
+                const pipeline_result c_result = {
+                    (long long)result.timestamp,
+                    faces.data(),
+                    int(faces.size()),
+                    int(result.dropped_frames)
+                };
+                callback(&c_result, user_data);
+            };
+
+            std::unique_ptr<pipeline_handle> handle(new pipeline_handle());
+            handle->pipeline.reset(new RecognitionPipeline(
+                checked_classifier(classifier),
+                checked_detector(detector),
+                matcher,
+                recognition_callback,
+                pipeline_options
+            ));
+            return handle.release();
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return NULL;
+        }
+    }
+
+    int pipeline_push_frame(
+        pipeline_handle* handle,
+        const int height,
+        const int width,
+        const int format,
+        const int step,
+        const unsigned char* data,
+        const long long timestamp,
+        int* dropped
+    ) {
+        try {
+            if (!handle || !data) {
+                throw std::invalid_argument("Pipeline handle and frame must not be NULL");
+            }
+
+            FrameFormat frame_format = FrameFormat::BGR_Frame;
+            cv::Mat frame;
+            switch (format) {
+                case PIPELINE_FRAME_BGR:
+                    frame = cv::Mat(height, width, CV_8UC3, (void*)data, step);
+                    break;
+                case PIPELINE_FRAME_NV12:
+                case PIPELINE_FRAME_I420:
+                    frame_format = format == PIPELINE_FRAME_NV12 ? FrameFormat::NV12_Frame : FrameFormat::I420_Frame;
+                    frame = cv::Mat(height * 3 / 2, width, CV_8UC1, (void*)data, step);
+                    break;
+                default:
+                    throw std::invalid_argument("Unknown frame format");
+            }
+
+            const bool result = handle->pipeline->push(frame, frame_format, timestamp);
+            if (dropped) {
+                *dropped = !result;
+            }
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int pipeline_dropped_frames(pipeline_handle* handle, long long* dropped) {
+        if (!handle || !dropped) {
+            set_error("Pipeline handle and dropped must not be NULL");
+            return EXIT_FAILURE;
+        }
+
+        *dropped = (long long)handle->pipeline->dropped();
+        return EXIT_SUCCESS;
+    }
+
+    int pipeline_statistics(
+        pipeline_handle* handle,
+        pipeline_stage_statistics* statistics,
+        const int capacity,
+        int* stage_count
+    ) {
+        try {
+            if (!handle || !stage_count || capacity < 0 || (capacity && !statistics)) {
+                throw std::invalid_argument("Pipeline handle, statistics and stage count must not be NULL");
+            }
+
+            // Stage names are kept until the next call in this thread
+            static thread_local std::vector<StageStatistics> stages;
+            stages = handle->pipeline->statistics();
+            for (size_t i = 0; i < std::min(stages.size(), size_t(capacity)); i++) {
+                statistics[i] = {
+                    stages[i].name.c_str(),
+                    (long long)stages[i].processed,
+                    (long long)stages[i].dropped,
+                    stages[i].average_ms,
+                    stages[i].p50_ms,
+                    stages[i].p95_ms,
+                    stages[i].p99_ms,
+                    stages[i].max_ms
+                };
+            }
+            *stage_count = int(stages.size());
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    void destroy_pipeline(pipeline_handle* handle) {
+        delete handle;
+    }
+
+    int init_ie_facenet_v1(const char* xml, const char* bin, const char* device) {
+        return init_ie_facenet_v1_with_options(xml, bin, device, NULL);
+    }
+
+    int init_ie_facenet_v1_with_options(
+        const char* xml,
+        const char* bin,
+        const char* device,
+        const classifier_options* options
+    ) {
+        if (std::atomic_load(&global_classifier)) {
+            set_error("Classifier has already been initialized");
+            return EXIT_FAILURE;
+        }
+
+        classifier_handle* handle = create_classifier(xml, bin, device, options);
+        if (!handle) {
+            return EXIT_FAILURE;
+        }
+
+        // Another thread may have initialized it while the network was loading
+        std::shared_ptr<Classifier> expected;
+        const bool initialized = std::atomic_compare_exchange_strong(
+            &global_classifier, &expected, handle->classifier);
+        destroy_classifier(handle);
+        if (!initialized) {
+            set_error("Classifier has already been initialized");
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int release_ie_facenet_v1() {
+        try {
+            std::atomic_store(&global_classifier, std::shared_ptr<Classifier>());
+        } catch(const std::exception& exception) {
+            set_error(exception.what());
+            return EXIT_FAILURE;
         }
 
         return EXIT_SUCCESS;
@@ -56,16 +750,9 @@ EXTERN_C
         float& result
     ) {
         try {
-            if (!classifier) {
-                throw new std::runtime_error("Classifier hasn't been initialized yet");
-            }
-
-            result = classifier->distance(
-                FaceDescriptor(dist1, dist1 + size),
-                FaceDescriptor(dist2, dist2 + size)
-            );
+            result = distance(*checked_global_classifier(), dist1, dist2, size);
         } catch(const std::exception& exception) {
-            exception_message = exception.what();
+            set_error(exception.what());
             return EXIT_FAILURE;
         }
 
@@ -83,19 +770,13 @@ EXTERN_C
         int& result_size
     ) {
         try {
-            if (!classifier) {
-                throw new std::runtime_error("Classifier hasn't been initialized yet");
-            }
-
-            cv::Mat face(height, width, type, (void*)data, step);
-            const FaceDescriptor desc = classifier->embed(face);
-            memcpy(result, desc.data(), sizeof(float) * desc.size());
-            result_size = desc.size();
+            embed(*checked_global_classifier(), height, width, type, step, data,
+                result, SIZE_OF_IEFACENET_V1, result_size);
         } catch(const std::exception& exception) {
-            exception_message = exception.what();
+            set_error(exception.what());
             return EXIT_FAILURE;
         }
 
         return EXIT_SUCCESS;
     }
-EXTERN_C_END
\ No newline at end of file
+EXTERN_C_END
@@ -7,9 +7,15 @@
 
 #include "ie_facenet_v1.hpp"
 
-std::shared_ptr<Classifier> build_classifier(ClassifierType type, const std::string xml, const std::string bin, const std::string device) {
+std::shared_ptr<Classifier> build_classifier(
+    ClassifierType type,
+    const std::string xml,
+    const std::string bin,
+    const std::string device,
+    const ClassifierOptions& options
+) {
     if (type == ClassifierType::IE_Facenet_V1) {
-        return std::shared_ptr<Classifier>(new IEFacenet_V1(xml, bin, device));
+        return std::shared_ptr<Classifier>(new IEFacenet_V1(xml, bin, device, options));
     } else {
         throw std::runtime_error("Unknown classifier type");
     }
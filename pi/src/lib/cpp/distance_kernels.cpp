@@ -0,0 +1,138 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <cmath>
+
+#if defined(__arm__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "distance_kernels.hpp"
+
+// Portable kernels, four accumulators let the compiler vectorize them with the baseline instruction set
+
+template <size_t Dimension>
+static float scalar_dot(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    float sum[4] = {0.f, 0.f, 0.f, 0.f};
+    size_t i = 0;
+    for (; i < n - n % 4; i += 4) {
+        sum[0] += first[i] * second[i];
+        sum[1] += first[i + 1] * second[i + 1];
+        sum[2] += first[i + 2] * second[i + 2];
+        sum[3] += first[i + 3] * second[i + 3];
+    }
+
+    float result = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    for (; i < n; i++) {
+        result += first[i] * second[i];
+    }
+
+    return result;
+}
+
+template <size_t Dimension>
+static float scalar_squared_l2(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    float sum[4] = {0.f, 0.f, 0.f, 0.f};
+    size_t i = 0;
+    for (; i < n - n % 4; i += 4) {
+        for (size_t j = 0; j < 4; j++) {
+            const float difference = first[i + j] - second[i + j];
+            sum[j] += difference * difference;
+        }
+    }
+
+    float result = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    for (; i < n; i++) {
+        const float difference = first[i] - second[i];
+        result += difference * difference;
+    }
+
+    return result;
+}
+
+template <size_t Dimension>
+static float scalar_cosine(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    float dot = 0.f;
+    float norm1 = 0.f;
+    float norm2 = 0.f;
+    for (size_t i = 0; i < n; i++) {
+        dot += first[i] * second[i];
+        norm1 += first[i] * first[i];
+        norm2 += second[i] * second[i];
+    }
+
+    const float norm = std::sqrt(norm1 * norm2);
+    return norm > 0.f ? dot / norm : 0.f;
+}
+
+DISTANCE_KERNEL_SELECTOR(scalar, scalar_cosine, scalar_squared_l2, scalar_dot)
+
+enum InstructionSet {
+    Scalar_ISA,
+    SSE4_ISA,
+    AVX2_ISA,
+    AVX512_ISA,
+    NEON_ISA,
+};
+
+// The best instruction set supported by both the build and the CPU, it is detected once
+static InstructionSet detect_instruction_set() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return InstructionSet::AVX512_ISA;
+    }
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return InstructionSet::AVX2_ISA;
+    }
+
+    if (__builtin_cpu_supports("sse4.1")) {
+        return InstructionSet::SSE4_ISA;
+    }
+#elif defined(__aarch64__)
+    return InstructionSet::NEON_ISA;
+#elif defined(__arm__) && defined(__linux__)
+    if (getauxval(AT_HWCAP) & HWCAP_NEON) {
+        return InstructionSet::NEON_ISA;
+    }
+#endif
+
+    return InstructionSet::Scalar_ISA;
+}
+
+static InstructionSet instruction_set() {
+    static const InstructionSet detected = detect_instruction_set();
+    return detected;
+}
+
+DistanceKernel distance_kernel(DistanceMetric metric, size_t dimension) {
+    switch (instruction_set()) {
+#if defined(__x86_64__) || defined(__i386__)
+        case InstructionSet::AVX512_ISA: return avx512_distance_kernel(metric, dimension);
+        case InstructionSet::AVX2_ISA: return avx2_distance_kernel(metric, dimension);
+        case InstructionSet::SSE4_ISA: return sse4_distance_kernel(metric, dimension);
+#elif defined(__arm__) || defined(__aarch64__)
+        case InstructionSet::NEON_ISA: return neon_distance_kernel(metric, dimension);
+#endif
+        default: return scalar_distance_kernel(metric, dimension);
+    }
+}
+
+const char* distance_kernel_isa() {
+    switch (instruction_set()) {
+        case InstructionSet::AVX512_ISA: return "AVX-512";
+        case InstructionSet::AVX2_ISA: return "AVX2";
+        case InstructionSet::SSE4_ISA: return "SSE4.1";
+        case InstructionSet::NEON_ISA: return "NEON";
+        default: return "scalar";
+    }
+}
@@ -0,0 +1,90 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+// Built with -mavx2 -mfma, called only if the CPU supports them
+
+#include <immintrin.h>
+
+#include "distance_kernels.hpp"
+
+static inline float avx2_sum(__m256 value) {
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    return _mm_cvtss_f32(half);
+}
+
+template <size_t Dimension>
+static float avx2_dot(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    __m256 sum1 = _mm256_setzero_ps();
+    __m256 sum2 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i < n - n % 16; i += 16) {
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(first + i), _mm256_loadu_ps(second + i), sum1);
+        sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(first + i + 8), _mm256_loadu_ps(second + i + 8), sum2);
+    }
+
+    float result = avx2_sum(_mm256_add_ps(sum1, sum2));
+    for (; i < n; i++) {
+        result += first[i] * second[i];
+    }
+
+    return result;
+}
+
+template <size_t Dimension>
+static float avx2_squared_l2(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    __m256 sum1 = _mm256_setzero_ps();
+    __m256 sum2 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i < n - n % 16; i += 16) {
+        const __m256 difference1 = _mm256_sub_ps(_mm256_loadu_ps(first + i), _mm256_loadu_ps(second + i));
+        const __m256 difference2 = _mm256_sub_ps(_mm256_loadu_ps(first + i + 8), _mm256_loadu_ps(second + i + 8));
+        sum1 = _mm256_fmadd_ps(difference1, difference1, sum1);
+        sum2 = _mm256_fmadd_ps(difference2, difference2, sum2);
+    }
+
+    float result = avx2_sum(_mm256_add_ps(sum1, sum2));
+    for (; i < n; i++) {
+        const float difference = first[i] - second[i];
+        result += difference * difference;
+    }
+
+    return result;
+}
+
+template <size_t Dimension>
+static float avx2_cosine(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    __m256 dot = _mm256_setzero_ps();
+    __m256 norm1 = _mm256_setzero_ps();
+    __m256 norm2 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i < n - n % 8; i += 8) {
+        const __m256 a = _mm256_loadu_ps(first + i);
+        const __m256 b = _mm256_loadu_ps(second + i);
+        dot = _mm256_fmadd_ps(a, b, dot);
+        norm1 = _mm256_fmadd_ps(a, a, norm1);
+        norm2 = _mm256_fmadd_ps(b, b, norm2);
+    }
+
+    float dot_sum = avx2_sum(dot);
+    float norm1_sum = avx2_sum(norm1);
+    float norm2_sum = avx2_sum(norm2);
+    for (; i < n; i++) {
+        dot_sum += first[i] * second[i];
+        norm1_sum += first[i] * first[i];
+        norm2_sum += second[i] * second[i];
+    }
+
+    const float norm = _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(norm1_sum * norm2_sum)));
+    return norm > 0.f ? dot_sum / norm : 0.f;
+}
+
+DISTANCE_KERNEL_SELECTOR(avx2, avx2_cosine, avx2_squared_l2, avx2_dot)
@@ -0,0 +1,83 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+// Built with -mavx512f, called only if the CPU supports it
+
+#include <immintrin.h>
+
+#include "distance_kernels.hpp"
+
+// Tails are processed with masked loads, so there is no scalar loop
+static inline __mmask16 avx512_tail(size_t count) {
+    return __mmask16((1u << count) - 1);
+}
+
+template <size_t Dimension>
+static float avx512_dot(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    __m512 sum1 = _mm512_setzero_ps();
+    __m512 sum2 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i < n - n % 32; i += 32) {
+        sum1 = _mm512_fmadd_ps(_mm512_loadu_ps(first + i), _mm512_loadu_ps(second + i), sum1);
+        sum2 = _mm512_fmadd_ps(_mm512_loadu_ps(first + i + 16), _mm512_loadu_ps(second + i + 16), sum2);
+    }
+
+    for (; i < n; i += 16) {
+        const __mmask16 mask = n - i >= 16 ? __mmask16(0xFFFF) : avx512_tail(n - i);
+        sum1 = _mm512_fmadd_ps(
+            _mm512_maskz_loadu_ps(mask, first + i), _mm512_maskz_loadu_ps(mask, second + i), sum1);
+    }
+
+    return _mm512_reduce_add_ps(_mm512_add_ps(sum1, sum2));
+}
+
+template <size_t Dimension>
+static float avx512_squared_l2(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    __m512 sum1 = _mm512_setzero_ps();
+    __m512 sum2 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i < n - n % 32; i += 32) {
+        const __m512 difference1 = _mm512_sub_ps(_mm512_loadu_ps(first + i), _mm512_loadu_ps(second + i));
+        const __m512 difference2 = _mm512_sub_ps(_mm512_loadu_ps(first + i + 16), _mm512_loadu_ps(second + i + 16));
+        sum1 = _mm512_fmadd_ps(difference1, difference1, sum1);
+        sum2 = _mm512_fmadd_ps(difference2, difference2, sum2);
+    }
+
+    for (; i < n; i += 16) {
+        const __mmask16 mask = n - i >= 16 ? __mmask16(0xFFFF) : avx512_tail(n - i);
+        const __m512 difference = _mm512_sub_ps(
+            _mm512_maskz_loadu_ps(mask, first + i), _mm512_maskz_loadu_ps(mask, second + i));
+        sum1 = _mm512_fmadd_ps(difference, difference, sum1);
+    }
+
+    return _mm512_reduce_add_ps(_mm512_add_ps(sum1, sum2));
+}
+
+template <size_t Dimension>
+static float avx512_cosine(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    __m512 dot = _mm512_setzero_ps();
+    __m512 norm1 = _mm512_setzero_ps();
+    __m512 norm2 = _mm512_setzero_ps();
+    for (size_t i = 0; i < n; i += 16) {
+        const __mmask16 mask = n - i >= 16 ? __mmask16(0xFFFF) : avx512_tail(n - i);
+        const __m512 a = _mm512_maskz_loadu_ps(mask, first + i);
+        const __m512 b = _mm512_maskz_loadu_ps(mask, second + i);
+        dot = _mm512_fmadd_ps(a, b, dot);
+        norm1 = _mm512_fmadd_ps(a, a, norm1);
+        norm2 = _mm512_fmadd_ps(b, b, norm2);
+    }
+
+    const float dot_sum = _mm512_reduce_add_ps(dot);
+    const float norm = _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(
+        _mm512_reduce_add_ps(norm1) * _mm512_reduce_add_ps(norm2))));
+    return norm > 0.f ? dot_sum / norm : 0.f;
+}
+
+DISTANCE_KERNEL_SELECTOR(avx512, avx512_cosine, avx512_squared_l2, avx512_dot)
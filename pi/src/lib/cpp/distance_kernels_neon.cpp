@@ -0,0 +1,92 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+// Built with NEON enabled, called only if the CPU supports it
+
+#include <arm_neon.h>
+
+#include "distance_kernels.hpp"
+
+static inline float neon_sum(float32x4_t value) {
+    const float32x2_t half = vadd_f32(vget_low_f32(value), vget_high_f32(value));
+    return vget_lane_f32(vpadd_f32(half, half), 0);
+}
+
+template <size_t Dimension>
+static float neon_dot(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    float32x4_t sum1 = vdupq_n_f32(0.f);
+    float32x4_t sum2 = vdupq_n_f32(0.f);
+    float32x4_t sum3 = vdupq_n_f32(0.f);
+    float32x4_t sum4 = vdupq_n_f32(0.f);
+    size_t i = 0;
+    for (; i < n - n % 16; i += 16) {
+        sum1 = vmlaq_f32(sum1, vld1q_f32(first + i), vld1q_f32(second + i));
+        sum2 = vmlaq_f32(sum2, vld1q_f32(first + i + 4), vld1q_f32(second + i + 4));
+        sum3 = vmlaq_f32(sum3, vld1q_f32(first + i + 8), vld1q_f32(second + i + 8));
+        sum4 = vmlaq_f32(sum4, vld1q_f32(first + i + 12), vld1q_f32(second + i + 12));
+    }
+
+    float result = neon_sum(vaddq_f32(vaddq_f32(sum1, sum2), vaddq_f32(sum3, sum4)));
+    for (; i < n; i++) {
+        result += first[i] * second[i];
+    }
+
+    return result;
+}
+
+template <size_t Dimension>
+static float neon_squared_l2(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    float32x4_t sum1 = vdupq_n_f32(0.f);
+    float32x4_t sum2 = vdupq_n_f32(0.f);
+    size_t i = 0;
+    for (; i < n - n % 8; i += 8) {
+        const float32x4_t difference1 = vsubq_f32(vld1q_f32(first + i), vld1q_f32(second + i));
+        const float32x4_t difference2 = vsubq_f32(vld1q_f32(first + i + 4), vld1q_f32(second + i + 4));
+        sum1 = vmlaq_f32(sum1, difference1, difference1);
+        sum2 = vmlaq_f32(sum2, difference2, difference2);
+    }
+
+    float result = neon_sum(vaddq_f32(sum1, sum2));
+    for (; i < n; i++) {
+        const float difference = first[i] - second[i];
+        result += difference * difference;
+    }
+
+    return result;
+}
+
+template <size_t Dimension>
+static float neon_cosine(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    float32x4_t dot = vdupq_n_f32(0.f);
+    float32x4_t norm1 = vdupq_n_f32(0.f);
+    float32x4_t norm2 = vdupq_n_f32(0.f);
+    size_t i = 0;
+    for (; i < n - n % 4; i += 4) {
+        const float32x4_t a = vld1q_f32(first + i);
+        const float32x4_t b = vld1q_f32(second + i);
+        dot = vmlaq_f32(dot, a, b);
+        norm1 = vmlaq_f32(norm1, a, a);
+        norm2 = vmlaq_f32(norm2, b, b);
+    }
+
+    float dot_sum = neon_sum(dot);
+    float norm1_sum = neon_sum(norm1);
+    float norm2_sum = neon_sum(norm2);
+    for (; i < n; i++) {
+        dot_sum += first[i] * second[i];
+        norm1_sum += first[i] * first[i];
+        norm2_sum += second[i] * second[i];
+    }
+
+    const float norm = __builtin_sqrtf(norm1_sum * norm2_sum);
+    return norm > 0.f ? dot_sum / norm : 0.f;
+}
+
+DISTANCE_KERNEL_SELECTOR(neon, neon_cosine, neon_squared_l2, neon_dot)
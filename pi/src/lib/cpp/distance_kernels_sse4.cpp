@@ -0,0 +1,89 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+// Built with -msse4.1, called only if the CPU supports it
+
+#include <smmintrin.h>
+
+#include "distance_kernels.hpp"
+
+static inline float sse4_sum(__m128 value) {
+    value = _mm_hadd_ps(value, value);
+    value = _mm_hadd_ps(value, value);
+    return _mm_cvtss_f32(value);
+}
+
+template <size_t Dimension>
+static float sse4_dot(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    __m128 sum1 = _mm_setzero_ps();
+    __m128 sum2 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i < n - n % 8; i += 8) {
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(first + i), _mm_loadu_ps(second + i)));
+        sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(first + i + 4), _mm_loadu_ps(second + i + 4)));
+    }
+
+    float result = sse4_sum(_mm_add_ps(sum1, sum2));
+    for (; i < n; i++) {
+        result += first[i] * second[i];
+    }
+
+    return result;
+}
+
+template <size_t Dimension>
+static float sse4_squared_l2(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    __m128 sum1 = _mm_setzero_ps();
+    __m128 sum2 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i < n - n % 8; i += 8) {
+        const __m128 difference1 = _mm_sub_ps(_mm_loadu_ps(first + i), _mm_loadu_ps(second + i));
+        const __m128 difference2 = _mm_sub_ps(_mm_loadu_ps(first + i + 4), _mm_loadu_ps(second + i + 4));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(difference1, difference1));
+        sum2 = _mm_add_ps(sum2, _mm_mul_ps(difference2, difference2));
+    }
+
+    float result = sse4_sum(_mm_add_ps(sum1, sum2));
+    for (; i < n; i++) {
+        const float difference = first[i] - second[i];
+        result += difference * difference;
+    }
+
+    return result;
+}
+
+template <size_t Dimension>
+static float sse4_cosine(const float* first, const float* second, size_t size) {
+    const size_t n = Dimension ? Dimension : size;
+    __m128 dot = _mm_setzero_ps();
+    __m128 norm1 = _mm_setzero_ps();
+    __m128 norm2 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i < n - n % 4; i += 4) {
+        const __m128 a = _mm_loadu_ps(first + i);
+        const __m128 b = _mm_loadu_ps(second + i);
+        dot = _mm_add_ps(dot, _mm_mul_ps(a, b));
+        norm1 = _mm_add_ps(norm1, _mm_mul_ps(a, a));
+        norm2 = _mm_add_ps(norm2, _mm_mul_ps(b, b));
+    }
+
+    float dot_sum = sse4_sum(dot);
+    float norm1_sum = sse4_sum(norm1);
+    float norm2_sum = sse4_sum(norm2);
+    for (; i < n; i++) {
+        dot_sum += first[i] * second[i];
+        norm1_sum += first[i] * first[i];
+        norm2_sum += second[i] * second[i];
+    }
+
+    const float norm = _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(norm1_sum * norm2_sum)));
+    return norm > 0.f ? dot_sum / norm : 0.f;
+}
+
+DISTANCE_KERNEL_SELECTOR(sse4, sse4_cosine, sse4_squared_l2, sse4_dot)
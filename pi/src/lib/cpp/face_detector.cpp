@@ -0,0 +1,27 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <stdexcept>
+
+#include "haar_face_detector.hpp"
+#include "ie_face_detector.hpp"
+
+std::shared_ptr<FaceDetector> build_detector(
+    DetectorType type,
+    const std::string model,
+    const std::string weights,
+    const std::string device,
+    const DetectorOptions& options
+) {
+    if (type == DetectorType::Haar_Cascade) {
+        return std::shared_ptr<FaceDetector>(new HaarFaceDetector(model, options));
+    } else if (type == DetectorType::IE_SSD) {
+        return std::shared_ptr<FaceDetector>(new IEFaceDetector(model, weights, device, options));
+    } else {
+        throw std::runtime_error("Unknown face detector type");
+    }
+}
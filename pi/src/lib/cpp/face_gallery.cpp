@@ -0,0 +1,301 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include "face_gallery.hpp"
+#include "distance_kernels.hpp"
+
+// Rows are padded with zeros up to this number of floats
+// It keeps every row 64-byte aligned and lets the kernel skip the tail
+static const size_t ROW_ALIGNMENT = 16;
+
+// Writes L2-normalized source into destination
+// Zero vector stays zero, so it never matches anything
+static void normalize(const float* source, float* destination, size_t size) {
+    float norm = 0;
+    for (size_t i = 0; i < size; i++) {
+        norm += source[i] * source[i];
+    }
+
+    const float scale = norm > 0 ? 1.f / std::sqrt(norm) : 0.f;
+    for (size_t i = 0; i < size; i++) {
+        destination[i] = source[i] * scale;
+    }
+}
+
+FaceGallery::FaceGallery(size_t dimension)
+    : _dimension(dimension)
+    , _stride(FaceGallery::stride(dimension))
+    , _size(0)
+    , _capacity(0)
+    , _descriptors(nullptr)
+    , _borrowed(false)
+    , _dot(distance_kernel(DistanceMetric::Dot_Product, _stride)) {
+    if (!dimension) {
+        throw std::invalid_argument("Gallery dimension must be positive");
+    }
+}
+
+FaceGallery::FaceGallery(size_t dimension, const float* rows, const unsigned int* ids, size_t count)
+    : FaceGallery(dimension) {
+    if (count && (!rows || !ids)) {
+        throw std::invalid_argument("Gallery rows and ids must not be NULL");
+    }
+
+    if (reinterpret_cast<uintptr_t>(rows) % (ROW_ALIGNMENT * sizeof(float))) {
+        throw std::invalid_argument("Gallery rows must be 64-byte aligned");
+    }
+
+    // Nothing is written through the pointer until own() copies the rows
+    this->_descriptors = const_cast<float*>(rows);
+    this->_borrowed = true;
+    this->_size = count;
+    this->_capacity = count;
+    this->_ids.assign(ids, ids + count);
+    this->_rows.reserve(count);
+    for (size_t row = 0; row < count; row++) {
+        this->_rows[ids[row]] = row;
+    }
+}
+
+size_t FaceGallery::stride(size_t dimension) {
+    return (dimension + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT;
+}
+
+void FaceGallery::own() {
+    if (this->_borrowed) {
+        this->reserve(std::max<size_t>(64, this->_size));
+    }
+}
+
+void FaceGallery::reserve(size_t capacity) {
+    if (capacity <= this->_capacity && !this->_borrowed) {
+        return;
+    }
+
+    const size_t bytes = capacity * this->_stride * sizeof(float);
+    float* descriptors = static_cast<float*>(std::aligned_alloc(ROW_ALIGNMENT * sizeof(float), bytes));
+    if (!descriptors) {
+        throw std::bad_alloc();
+    }
+
+    if (this->_descriptors) {
+        memcpy(descriptors, this->_descriptors, this->_size * this->_stride * sizeof(float));
+        if (!this->_borrowed) {
+            std::free(this->_descriptors);
+        }
+    }
+
+    this->_descriptors = descriptors;
+    this->_capacity = capacity;
+    this->_borrowed = false;
+}
+
+void FaceGallery::add(unsigned int id, const FaceDescriptor& descriptor) {
+    if (descriptor.size() != this->_dimension) {
+        throw std::invalid_argument("Descriptor size doesn't match the gallery dimension");
+    }
+
+    this->add(id, descriptor.data());
+}
+
+void FaceGallery::add(unsigned int id, const float* descriptor) {
+    this->own();
+    size_t row = 0;
+    const auto existing = this->_rows.find(id);
+    if (existing != this->_rows.end()) {
+        row = existing->second;
+    } else {
+        if (this->_size == this->_capacity) {
+            this->reserve(std::max<size_t>(64, this->_capacity * 2));
+        }
+
+        row = this->_size++;
+        this->_ids.push_back(id);
+        this->_rows[id] = row;
+    }
+
+    float* destination = this->_descriptors + row * this->_stride;
+    normalize(descriptor, destination, this->_dimension);
+    std::fill(destination + this->_dimension, destination + this->_stride, 0.f);
+}
+
+void FaceGallery::add(const unsigned int* ids, const float* descriptors, size_t count) {
+    this->reserve(this->_size + count);
+    for (size_t i = 0; i < count; i++) {
+        this->add(ids[i], descriptors + i * this->_dimension);
+    }
+}
+
+bool FaceGallery::remove(unsigned int id) {
+    const auto existing = this->_rows.find(id);
+    if (existing == this->_rows.end()) {
+        return false;
+    }
+
+    // Move the last row into the released place to keep the matrix dense
+    this->own();
+    const size_t row = existing->second;
+    const size_t last = this->_size - 1;
+    if (row != last) {
+        memcpy(
+            this->_descriptors + row * this->_stride,
+            this->_descriptors + last * this->_stride,
+            this->_stride * sizeof(float)
+        );
+
+        this->_ids[row] = this->_ids[last];
+        this->_rows[this->_ids[row]] = row;
+    }
+
+    this->_rows.erase(id);
+    this->_ids.pop_back();
+    this->_size--;
+    return true;
+}
+
+void FaceGallery::clear() {
+    if (this->_borrowed) {
+        this->_descriptors = nullptr;
+        this->_capacity = 0;
+        this->_borrowed = false;
+    }
+
+    this->_rows.clear();
+    this->_ids.clear();
+    this->_size = 0;
+}
+
+void FaceGallery::assign(const FaceGallery& source) {
+    if (source._dimension != this->_dimension) {
+        throw std::invalid_argument("Source gallery dimension doesn't match");
+    }
+
+    this->clear();
+    this->reserve(std::max<size_t>(64, source._size));
+    if (source._size) {
+        memcpy(this->_descriptors, source._descriptors, source._size * this->_stride * sizeof(float));
+    }
+    this->_ids = source._ids;
+    this->_rows = source._rows;
+    this->_size = source._size;
+}
+
+bool FaceGallery::contains(unsigned int id) const {
+    return this->_rows.count(id) > 0;
+}
+
+bool FaceGallery::descriptor(unsigned int id, FaceDescriptor& descriptor) const {
+    const auto existing = this->_rows.find(id);
+    if (existing == this->_rows.end()) {
+        return false;
+    }
+
+    const float* row = this->_descriptors + existing->second * this->_stride;
+    descriptor.assign(row, row + this->_dimension);
+    return true;
+}
+
+size_t FaceGallery::size() const {
+    return this->_size;
+}
+
+size_t FaceGallery::dimension() const {
+    return this->_dimension;
+}
+
+const float* FaceGallery::rows() const {
+    return this->_descriptors;
+}
+
+const unsigned int* FaceGallery::ids() const {
+    return this->_ids.data();
+}
+
+size_t FaceGallery::stride() const {
+    return this->_stride;
+}
+
+std::vector<GalleryMatch> FaceGallery::search(const FaceDescriptor& probe, size_t k, float threshold) const {
+    if (probe.size() != this->_dimension) {
+        throw std::invalid_argument("Probe size doesn't match the gallery dimension");
+    }
+
+    return this->search(probe.data(), k, threshold);
+}
+
+std::vector<GalleryMatch> FaceGallery::search(const float* probe, size_t k, float threshold) const {
+    std::vector<GalleryMatch> matches(std::min(k, this->_size));
+    matches.resize(this->search(probe, k, threshold, matches.data()));
+    return matches;
+}
+
+size_t FaceGallery::search(const float* probe, size_t k, float threshold, GalleryMatch* matches) const {
+    if (!k || !this->_size) {
+        return 0;
+    }
+
+    // The probe is prepared exactly as gallery rows
+    // Buffers are reused by next searches in the same thread
+    static thread_local std::vector<float> normalized;
+    normalized.assign(this->_stride, 0.f);
+    normalize(probe, normalized.data(), this->_dimension);
+
+    // Distance is monotonic in similarity, so compare similarities
+    // and compute acos only for the matches which are returned
+    const float min_similarity = std::cos(std::min(std::max(threshold, 0.f), float(M_PI)));
+
+    typedef std::pair<float, size_t> Candidate;
+    const auto worse = [](const Candidate& a, const Candidate& b) -> bool {
+        return a.first > b.first;
+    };
+
+    // Min-heap of the best k candidates, the worst of them is on the top
+    static thread_local std::vector<Candidate> heap;
+    heap.clear();
+    heap.reserve(std::min(k, this->_size) + 1);
+    for (size_t row = 0; row < this->_size; row++) {
+        const float similarity = this->_dot(
+            this->_descriptors + row * this->_stride,
+            normalized.data(),
+            this->_stride
+        );
+
+        if (similarity < min_similarity) {
+            continue;
+        }
+
+        if (heap.size() < k) {
+            heap.emplace_back(similarity, row);
+            std::push_heap(heap.begin(), heap.end(), worse);
+        } else if (similarity > heap.front().first) {
+            std::pop_heap(heap.begin(), heap.end(), worse);
+            heap.back() = Candidate(similarity, row);
+            std::push_heap(heap.begin(), heap.end(), worse);
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end(), worse);
+    for (size_t i = 0; i < heap.size(); i++) {
+        const float similarity = std::min(std::max(heap[i].first, -1.f), 1.f);
+        matches[i] = {this->_ids[heap[i].second], std::acos(similarity)};
+    }
+
+    return heap.size();
+}
+
+FaceGallery::~FaceGallery() {
+    if (!this->_borrowed) {
+        std::free(this->_descriptors);
+    }
+}
@@ -0,0 +1,129 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <cmath>
+#include <tuple>
+#include <algorithm>
+
+#include "face_tracker.hpp"
+
+static float intersection_over_union(const cv::Rect& first, const cv::Rect& second) {
+    const float intersection = float((first & second).area());
+    const float united = float(first.area() + second.area()) - intersection;
+    return united > 0.f ? intersection / united : 0.f;
+}
+
+// Centroid distance in widths of the previous face
+static float centroid_shift(const cv::Rect& previous, const cv::Rect& current) {
+    const float dx = (current.x + current.width * 0.5f) - (previous.x + previous.width * 0.5f);
+    const float dy = (current.y + current.height * 0.5f) - (previous.y + previous.height * 0.5f);
+    return std::sqrt(dx * dx + dy * dy) / std::max(previous.width, 1);
+}
+
+FaceTracker::FaceTracker(const TrackerOptions& options)
+    : _options(options)
+    , _next_id(0) {
+}
+
+std::vector<Track>& FaceTracker::update(const std::vector<cv::Rect>& faces) {
+    // Track index for every face, -1 if the face is new
+    std::vector<int> face_tracks(faces.size(), -1);
+    this->_matched.assign(this->_tracks.size(), false);
+
+    // Greedy assignment, the best pairs are taken first
+    // Overlapping faces are matched before the centroid fallback
+    std::vector<std::tuple<float, size_t, size_t>> pairs;
+    for (int pass = 0; pass < 2; pass++) {
+        pairs.clear();
+        for (size_t t = 0; t < this->_tracks.size(); t++) {
+            if (this->_matched[t]) {
+                continue;
+            }
+
+            for (size_t f = 0; f < faces.size(); f++) {
+                if (face_tracks[f] >= 0) {
+                    continue;
+                }
+
+                if (pass == 0) {
+                    const float iou = intersection_over_union(this->_tracks[t].face, faces[f]);
+                    if (iou >= this->_options.min_iou) {
+                        pairs.emplace_back(-iou, t, f);
+                    }
+                } else {
+                    const float shift = centroid_shift(this->_tracks[t].face, faces[f]);
+                    if (shift <= this->_options.max_centroid_shift) {
+                        pairs.emplace_back(shift, t, f);
+                    }
+                }
+            }
+        }
+
+        std::sort(pairs.begin(), pairs.end());
+        for (const auto& pair: pairs) {
+            const size_t t = std::get<1>(pair);
+            const size_t f = std::get<2>(pair);
+            if (!this->_matched[t] && face_tracks[f] < 0) {
+                this->_matched[t] = true;
+                face_tracks[f] = int(t);
+            }
+        }
+    }
+
+    for (size_t f = 0; f < faces.size(); f++) {
+        if (face_tracks[f] < 0) {
+            continue;
+        }
+
+        Track& track = this->_tracks[face_tracks[f]];
+        track.face = faces[f];
+        track.missed = 0;
+        track.since_embedding++;
+        track.embed =
+            (this->_options.refresh_frames && track.since_embedding >= this->_options.refresh_frames)
+            || float(track.face.area()) >= track.embedded_quality * this->_options.quality_gain;
+    }
+
+    // Lost tracks keep their identity for a while, the face may be missed by the detector
+    for (size_t t = 0; t < this->_matched.size(); t++) {
+        if (!this->_matched[t]) {
+            this->_tracks[t].missed++;
+            this->_tracks[t].embed = false;
+        }
+    }
+
+    this->_tracks.erase(
+        std::remove_if(this->_tracks.begin(), this->_tracks.end(), [this](const Track& track) -> bool {
+            return track.missed > this->_options.max_missed;
+        }),
+        this->_tracks.end()
+    );
+
+    for (size_t f = 0; f < faces.size(); f++) {
+        if (face_tracks[f] < 0) {
+            this->_tracks.push_back({this->_next_id++, faces[f], 0, true, 0, 0.f, false, 0, 0.f});
+        }
+    }
+
+    // The caller embeds these faces now
+    for (Track& track: this->_tracks) {
+        if (track.embed) {
+            track.since_embedding = 0;
+            track.embedded_quality = float(track.face.area());
+        }
+    }
+
+    return this->_tracks;
+}
+
+const std::vector<Track>& FaceTracker::tracks() const {
+    return this->_tracks;
+}
+
+void FaceTracker::clear() {
+    this->_tracks.clear();
+}
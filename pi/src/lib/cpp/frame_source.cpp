@@ -0,0 +1,113 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <thread>
+#include <cctype>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+
+#include "frame_source.hpp"
+
+static bool is_number(const std::string& input) {
+    return !input.empty() && std::all_of(input.begin(), input.end(), [](char c) {
+        return std::isdigit(static_cast<unsigned char>(c));
+    });
+}
+
+static bool is_directory(const std::string& input) {
+    struct stat info;
+    return stat(input.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+static bool is_image(const std::string& path) {
+    const size_t dot = path.rfind('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) {
+        return char(std::tolower(static_cast<unsigned char>(c)));
+    });
+    return extension == "jpg" || extension == "jpeg" || extension == "png" || extension == "bmp";
+}
+
+FrameSource::FrameSource(const std::string& input, double fps)
+    : _next_image(0)
+    , _camera(false)
+    , _fps(fps > 0. ? fps : 0.)
+    , _frames(0) {
+    if (is_number(input)) {
+        this->_camera = true;
+        this->_capture.open(std::stoi(input));
+    } else if (is_directory(input)) {
+        std::vector<cv::String> files;
+        cv::glob(input, files, false);
+        for (const cv::String& file: files) {
+            if (is_image(file)) {
+                this->_images.push_back(file);
+            }
+        }
+
+        std::sort(this->_images.begin(), this->_images.end());
+        if (this->_images.empty()) {
+            throw std::runtime_error("No images in the directory " + input);
+        }
+    } else {
+        this->_capture.open(input);
+    }
+
+    if (this->_images.empty() && !this->_capture.isOpened()) {
+        throw std::runtime_error("Couldn't open a video stream " + input);
+    }
+}
+
+bool FrameSource::read(cv::Mat& frame) {
+    frame.release();
+    if (this->_images.empty()) {
+        this->_capture >> frame;
+    } else {
+        // Unreadable files are skipped
+        while (frame.empty() && this->_next_image < this->_images.size()) {
+            frame = cv::imread(this->_images[this->_next_image++], cv::IMREAD_COLOR);
+        }
+    }
+
+    if (frame.empty()) {
+        return false;
+    }
+
+    // Frames are due at fixed points counted from the first one, so a late frame doesn't delay the next ones
+    if (this->_fps > 0.) {
+        if (!this->_frames) {
+            this->_start = std::chrono::steady_clock::now();
+        }
+
+        std::this_thread::sleep_until(this->_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(this->_frames / this->_fps)));
+    }
+
+    this->_frames++;
+    return true;
+}
+
+void FrameSource::set_resolution(int width, int height) {
+    if (this->_camera) {
+        this->_capture.set(cv::CAP_PROP_FRAME_WIDTH, width);
+        this->_capture.set(cv::CAP_PROP_FRAME_HEIGHT, height);
+    }
+}
+
+bool FrameSource::is_camera() const {
+    return this->_camera;
+}
+
+uint64_t FrameSource::frames() const {
+    return this->_frames;
+}
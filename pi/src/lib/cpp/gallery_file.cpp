@@ -0,0 +1,211 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <cstring>
+#include <vector>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gallery_file.hpp"
+#include "synced_file.hpp"
+
+static const char GALLERY_MAGIC[8] = {'P', 'I', 'G', 'A', 'L', 'L', 'R', 'Y'};
+static const uint32_t GALLERY_FORMAT_VERSION = 1;
+static const uint64_t ROWS_ALIGNMENT = 64;
+
+static_assert(sizeof(GalleryFileHeader) == 96, "Gallery file header layout must not depend on the compiler");
+static_assert(sizeof(unsigned int) == sizeof(uint32_t), "Gallery ids are written as 32-bit numbers");
+
+static uint64_t align(uint64_t offset, uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+MappedGallery::MappedGallery(const std::string& path)
+    : _data(MAP_FAILED)
+    , _length(0) {
+    const int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        throw system_error("Could not open the gallery", path);
+    }
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0) {
+        close(descriptor);
+        throw system_error("Could not stat the gallery", path);
+    }
+
+    this->_length = size_t(info.st_size);
+    if (this->_length < sizeof(GalleryFileHeader)) {
+        close(descriptor);
+        throw std::runtime_error("Gallery " + path + " is too short");
+    }
+
+    // The mapping stays valid after the file is closed or replaced by rename
+    this->_data = mmap(nullptr, this->_length, PROT_READ, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    if (this->_data == MAP_FAILED) {
+        throw system_error("Could not map the gallery", path);
+    }
+
+    try {
+        const char* bytes = static_cast<const char*>(this->_data);
+        this->_header = reinterpret_cast<const GalleryFileHeader*>(bytes);
+        const GalleryFileHeader& header = *this->_header;
+        if (memcmp(header.magic, GALLERY_MAGIC, sizeof(GALLERY_MAGIC)) != 0) {
+            throw std::runtime_error("File " + path + " isn't a gallery");
+        }
+
+        if (header.format_version != GALLERY_FORMAT_VERSION) {
+            throw std::runtime_error("Gallery " + path + " has unsupported format version "
+                + std::to_string(header.format_version));
+        }
+
+        if (!header.dimension || header.stride != FaceGallery::stride(header.dimension)) {
+            throw std::runtime_error("Gallery " + path + " has wrong descriptor dimension");
+        }
+
+        // Sections must lie inside the file, sizes are checked against the length to avoid overflows
+        const uint64_t length = this->_length;
+        const uint64_t count = header.count;
+        const uint64_t row_bytes = uint64_t(header.stride) * sizeof(float);
+        const bool valid = count <= length / sizeof(uint32_t)
+            && header.ids_offset <= length && count * sizeof(uint32_t) <= length - header.ids_offset
+            && header.metadata_offset % sizeof(uint64_t) == 0
+            && header.metadata_offset <= length && header.metadata_size <= length - header.metadata_offset
+            && (count + 1) * sizeof(uint64_t) <= header.metadata_size
+            && header.descriptors_offset % ROWS_ALIGNMENT == 0
+            && header.descriptors_offset <= length && count <= (length - header.descriptors_offset) / row_bytes;
+        if (!valid) {
+            throw std::runtime_error("Gallery " + path + " is damaged");
+        }
+
+        this->_metadata_offsets = reinterpret_cast<const uint64_t*>(bytes + header.metadata_offset);
+        this->_metadata = bytes + header.metadata_offset + (count + 1) * sizeof(uint64_t);
+        if (this->_metadata_offsets[count] > header.metadata_size - (count + 1) * sizeof(uint64_t)) {
+            throw std::runtime_error("Gallery " + path + " has damaged metadata");
+        }
+
+        this->_gallery.reset(new FaceGallery(
+            header.dimension,
+            reinterpret_cast<const float*>(bytes + header.descriptors_offset),
+            reinterpret_cast<const unsigned int*>(bytes + header.ids_offset),
+            size_t(count)
+        ));
+    } catch (...) {
+        munmap(this->_data, this->_length);
+        throw;
+    }
+}
+
+std::string MappedGallery::network_version() const {
+    const char* version = this->_header->network_version;
+    return std::string(version, strnlen(version, sizeof(this->_header->network_version)));
+}
+
+size_t MappedGallery::dimension() const {
+    return this->_header->dimension;
+}
+
+size_t MappedGallery::size() const {
+    return size_t(this->_header->count);
+}
+
+unsigned int MappedGallery::id(size_t row) const {
+    if (row >= this->size()) {
+        throw std::out_of_range("Gallery row is out of range");
+    }
+
+    const char* bytes = static_cast<const char*>(this->_data);
+    return reinterpret_cast<const uint32_t*>(bytes + this->_header->ids_offset)[row];
+}
+
+std::string MappedGallery::metadata(size_t row) const {
+    if (row >= this->size()) {
+        throw std::out_of_range("Gallery row is out of range");
+    }
+
+    const uint64_t begin = this->_metadata_offsets[row];
+    const uint64_t end = this->_metadata_offsets[row + 1];
+    if (begin > end || end > this->_metadata_offsets[this->size()]) {
+        throw std::runtime_error("Gallery metadata is damaged");
+    }
+
+    return std::string(this->_metadata + begin, size_t(end - begin));
+}
+
+FaceGallery& MappedGallery::gallery() {
+    return *this->_gallery;
+}
+
+const FaceGallery& MappedGallery::gallery() const {
+    return *this->_gallery;
+}
+
+MappedGallery::~MappedGallery() {
+    // The gallery may still point into the file
+    this->_gallery.reset();
+    munmap(this->_data, this->_length);
+}
+
+void write_gallery_file(
+    const std::string& path,
+    const std::string& network_version,
+    const FaceGallery& gallery,
+    const GalleryMetadata& metadata
+) {
+    GalleryFileHeader header;
+    memset(&header, 0, sizeof(header));
+    if (network_version.size() >= sizeof(header.network_version)) {
+        throw std::invalid_argument("Network version is too long for the gallery file");
+    }
+
+    const uint64_t count = gallery.size();
+    std::vector<std::string> records(count);
+    std::vector<uint64_t> offsets(count + 1, 0);
+    for (size_t row = 0; row < count; row++) {
+        records[row] = metadata ? metadata(gallery.ids()[row]) : std::string();
+        offsets[row + 1] = offsets[row] + records[row].size();
+    }
+
+    memcpy(header.magic, GALLERY_MAGIC, sizeof(GALLERY_MAGIC));
+    header.format_version = GALLERY_FORMAT_VERSION;
+    header.dimension = uint32_t(gallery.dimension());
+    header.stride = uint32_t(gallery.stride());
+    header.count = count;
+    memcpy(header.network_version, network_version.data(), network_version.size());
+    header.ids_offset = sizeof(header);
+    header.metadata_offset = align(header.ids_offset + count * sizeof(uint32_t), sizeof(uint64_t));
+    header.metadata_size = (count + 1) * sizeof(uint64_t) + offsets[count];
+    header.descriptors_offset = align(header.metadata_offset + header.metadata_size, ROWS_ALIGNMENT);
+
+    // A failed write leaves the old file untouched
+    const std::string temporary = path + ".tmp";
+    try {
+        SyncedFile writer(temporary, O_TRUNC);
+        writer.write(&header, sizeof(header));
+        writer.write(gallery.ids(), size_t(count) * sizeof(uint32_t));
+        writer.pad(header.metadata_offset);
+        writer.write(offsets.data(), offsets.size() * sizeof(uint64_t));
+        for (const std::string& record: records) {
+            writer.write(record.data(), record.size());
+        }
+        writer.pad(header.descriptors_offset);
+        writer.write(gallery.rows(), size_t(count) * gallery.stride() * sizeof(float));
+        writer.sync();
+    } catch (...) {
+        unlink(temporary.c_str());
+        throw;
+    }
+
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        throw system_error("Could not replace the gallery", path);
+    }
+    sync_directory(path);
+}
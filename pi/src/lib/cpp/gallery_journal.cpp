@@ -0,0 +1,177 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+
+#include "gallery_journal.hpp"
+#include "synced_file.hpp"
+
+// Record is the payload size, the payload checksum and the payload:
+// type, id, descriptor size, metadata size (all uint32_t), descriptor floats and metadata bytes
+struct RecordHeader {
+    uint32_t size;
+    uint32_t checksum;
+};
+
+struct RecordPayload {
+    uint32_t type;
+    uint32_t id;
+    uint32_t dimension;
+    uint32_t metadata_size;
+};
+
+// FNV-1a, it only has to notice a torn write
+static uint32_t checksum(const char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ uint8_t(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+// Applies the records and returns the size of the valid part of the file
+static uint64_t read_journal(
+    const std::string& path,
+    const std::function<void(const JournalRecord&)>& apply,
+    size_t& records
+) {
+    records = 0;
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string data = buffer.str();
+
+    uint64_t offset = 0;
+    JournalRecord record;
+    while (data.size() - offset >= sizeof(RecordHeader)) {
+        RecordHeader header;
+        memcpy(&header, data.data() + offset, sizeof(header));
+        const char* payload = data.data() + offset + sizeof(header);
+        if (header.size < sizeof(RecordPayload) || header.size > data.size() - offset - sizeof(header)
+            || checksum(payload, header.size) != header.checksum) {
+            break;
+        }
+
+        RecordPayload fields;
+        memcpy(&fields, payload, sizeof(fields));
+        const uint64_t expected = sizeof(fields) + uint64_t(fields.dimension) * sizeof(float) + fields.metadata_size;
+        const bool known = fields.type == uint32_t(JournalRecordType::Add)
+            || fields.type == uint32_t(JournalRecordType::Remove);
+        if (expected != header.size || !known) {
+            break;
+        }
+
+        record.type = JournalRecordType(fields.type);
+        record.id = fields.id;
+        record.descriptor.resize(fields.dimension);
+        memcpy(record.descriptor.data(), payload + sizeof(fields), fields.dimension * sizeof(float));
+        record.metadata.assign(payload + sizeof(fields) + fields.dimension * sizeof(float), fields.metadata_size);
+        if (apply) {
+            apply(record);
+        }
+
+        offset += sizeof(header) + header.size;
+        records++;
+    }
+
+    return offset;
+}
+
+size_t replay_journal(const std::string& path, const std::function<void(const JournalRecord&)>& apply) {
+    size_t records = 0;
+    read_journal(path, apply, records);
+    return records;
+}
+
+GalleryJournal::GalleryJournal(const std::string& path)
+    : _path(path)
+    , _records(0)
+    , _end(0) {
+    const uint64_t valid = read_journal(path, nullptr, this->_records);
+    this->_file.reset(new SyncedFile(path, 0));
+    if (this->_file->offset() != valid) {
+        this->_file->truncate(valid);
+        this->_file->sync();
+    }
+    this->_end = valid;
+}
+
+void GalleryJournal::append(const JournalRecord& record) {
+    RecordPayload fields;
+    fields.type = uint32_t(record.type);
+    fields.id = record.id;
+    fields.dimension = uint32_t(record.descriptor.size());
+    fields.metadata_size = uint32_t(record.metadata.size());
+
+    // The record goes with one write, so a crash tears at most the last record
+    std::string payload(reinterpret_cast<const char*>(&fields), sizeof(fields));
+    payload.append(reinterpret_cast<const char*>(record.descriptor.data()), record.descriptor.size() * sizeof(float));
+    payload.append(record.metadata);
+
+    RecordHeader header;
+    header.size = uint32_t(payload.size());
+    header.checksum = checksum(payload.data(), payload.size());
+    payload.insert(0, reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Replay stops at a torn record, so nothing may be appended after one
+    // The cut is retried here if it failed together with the previous append
+    if (this->_file->offset() != this->_end) {
+        this->_file->truncate(this->_end);
+        this->_file->sync();
+    }
+
+    try {
+        this->_file->write(payload.data(), payload.size());
+        this->_file->sync();
+    } catch (std::exception&) {
+        try {
+            this->_file->truncate(this->_end);
+            this->_file->sync();
+        } catch (std::exception&) {
+            // The next append cuts the file before writing
+        }
+        throw;
+    }
+
+    this->_end = this->_file->offset();
+    this->_records++;
+}
+
+void GalleryJournal::add(unsigned int id, const std::vector<float>& descriptor, const std::string& metadata) {
+    this->append(JournalRecord{JournalRecordType::Add, id, descriptor, metadata});
+}
+
+void GalleryJournal::remove(unsigned int id) {
+    this->append(JournalRecord{JournalRecordType::Remove, id, std::vector<float>(), std::string()});
+}
+
+size_t GalleryJournal::records() const {
+    return this->_records;
+}
+
+void GalleryJournal::rotate(const std::string& path) {
+    if (std::rename(this->_path.c_str(), path.c_str()) != 0) {
+        throw system_error("Could not rotate the journal", this->_path);
+    }
+
+    this->_file.reset(new SyncedFile(this->_path, O_TRUNC));
+    this->_records = 0;
+    this->_end = 0;
+    sync_directory(this->_path);
+}
+
+GalleryJournal::~GalleryJournal() {}
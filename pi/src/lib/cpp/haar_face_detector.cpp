@@ -0,0 +1,65 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <stdexcept>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "haar_face_detector.hpp"
+
+// Minimum face size if the options leave it empty
+static const cv::Size HAAR_MIN_FACE_SIZE = cv::Size(150, 150);
+
+HaarFaceDetector::HaarFaceDetector(const std::string cascade, const DetectorOptions& options)
+    : _options(options) {
+    if (!this->_cascade.load(cascade)) {
+        throw std::runtime_error("Could not load the face detector " + cascade);
+    }
+}
+
+void HaarFaceDetector::detect(const cv::Mat& frame, std::vector<cv::Rect>& faces) {
+    // The buffers are reused by next calls in the same thread
+    static thread_local cv::Mat gray, small;
+    if (frame.channels() == 1) {
+        gray = frame;
+    } else {
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    }
+
+    // The cascade cost grows with the number of pixels, faces stay large enough after downscaling
+    const int width = this->_options.detection_width;
+    const double scale = width > 0 && frame.cols > width ? double(width) / frame.cols : 1.;
+    cv::Size min_face_size = this->_options.min_face_size.empty()
+        ? HAAR_MIN_FACE_SIZE : this->_options.min_face_size;
+    if (scale < 1.) {
+        cv::resize(gray, small, cv::Size(), scale, scale, cv::INTER_AREA);
+        min_face_size = cv::Size(cvRound(min_face_size.width * scale), cvRound(min_face_size.height * scale));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_cascade.detectMultiScale(
+            scale < 1. ? small : gray,
+            faces,
+            this->_options.scale_factor,
+            this->_options.min_neighbors,
+            0,
+            min_face_size
+        );
+    }
+
+    if (scale < 1.) {
+        const cv::Rect bounds(0, 0, frame.cols, frame.rows);
+        for (cv::Rect& face: faces) {
+            face = cv::Rect(
+                cvRound(face.x / scale),
+                cvRound(face.y / scale),
+                cvRound(face.width / scale),
+                cvRound(face.height / scale)
+            ) & bounds;
+        }
+    }
+}
@@ -0,0 +1,205 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+#include "ie_common.hpp"
+
+std::shared_ptr<InferenceEngine::Core> shared_core() {
+    static std::mutex mutex;
+    static std::weak_ptr<InferenceEngine::Core> instance;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<InferenceEngine::Core> core = instance.lock();
+    if (!core) {
+        core = std::make_shared<InferenceEngine::Core>();
+        instance = core;
+    }
+
+    return core;
+}
+
+// FNV-1a hash, it is used to build a key of the compiled network cache
+static uint64_t hash_bytes(const char* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= uint8_t(data[i]);
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+static uint64_t hash_string(const std::string& data, uint64_t hash) {
+    return hash_bytes(data.c_str(), data.size() + 1, hash);
+}
+
+// Returns path to the compiled network in the cache directory
+// The key covers the model, the device, the inference engine version and the network configuration,
+// so a compiled network is never imported for something else
+// Weights are keyed by their size and modification time to avoid reading them on warm start
+static std::string cached_network_path(
+    InferenceEngine::Core& ie,
+    const std::string& cache_dir,
+    const std::string& name,
+    const std::string& xml,
+    const std::string& bin,
+    const std::string& device,
+    const std::string& configuration
+) {
+    std::ifstream xml_file(xml, std::ios::in | std::ios::binary);
+    if (!xml_file.is_open()) {
+        throw std::runtime_error("Could not open the model definition " + xml);
+    }
+
+    std::stringstream xml_content;
+    xml_content << xml_file.rdbuf();
+
+    struct stat bin_stat;
+    if (stat(bin.c_str(), &bin_stat)) {
+        throw std::runtime_error("Could not open the model weights " + bin);
+    }
+
+    uint64_t hash = hash_string(xml_content.str(), 14695981039346656037ULL);
+    hash = hash_string(std::to_string(bin_stat.st_size) + ":" + std::to_string(bin_stat.st_mtime), hash);
+    hash = hash_string(device, hash);
+    hash = hash_string(configuration, hash);
+    hash = hash_string(InferenceEngine::GetInferenceEngineVersion()->buildNumber, hash);
+    for (const auto& version: ie.GetVersions(device)) {
+        hash = hash_string(version.first, hash);
+        hash = hash_string(version.second.buildNumber, hash);
+        hash = hash_string(version.second.description, hash);
+    }
+
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+    return cache_dir + "/" + name + "_" + key + ".blob";
+}
+
+InferenceEngine::ExecutableNetwork load_cached_network(
+    InferenceEngine::Core& ie,
+    const std::string& cache_dir,
+    const std::string& name,
+    const std::string& xml,
+    const std::string& bin,
+    const std::string& device,
+    const std::map<std::string, std::string>& config,
+    const std::string& configuration,
+    const std::function<InferenceEngine::ExecutableNetwork()>& load
+) {
+    std::string cache_file;
+    if (!cache_dir.empty()) {
+        std::string key = configuration;
+        for (const auto& item: config) {
+            key += ":" + item.first + "=" + item.second;
+        }
+
+        cache_file = cached_network_path(ie, cache_dir, name, xml, bin, device, key);
+    }
+
+    // Import previously compiled network if any
+    // Broken or incompatible file is removed and the network is compiled again
+    if (!cache_file.empty() && std::ifstream(cache_file).good()) {
+        try {
+            return ie.ImportNetwork(cache_file, device, config);
+        } catch (const std::exception&) {
+            std::remove(cache_file.c_str());
+        }
+    }
+
+    InferenceEngine::ExecutableNetwork executable = load();
+
+    // Not all plugins can export networks, the cache is just skipped for them
+    if (!cache_file.empty()) {
+        const std::string temporary_file = cache_file + ".tmp";
+        try {
+            mkdir(cache_dir.c_str(), 0755);
+            executable.Export(temporary_file);
+            if (std::rename(temporary_file.c_str(), cache_file.c_str())) {
+                std::remove(temporary_file.c_str());
+            }
+        } catch (const std::exception&) {
+            std::remove(temporary_file.c_str());
+        }
+    }
+
+    return executable;
+}
+
+InferRequestPool::InferRequestPool(
+    InferenceEngine::ExecutableNetwork& executable,
+    size_t size,
+    size_t batch_size
+) {
+    using namespace InferenceEngine;
+
+    ConstInputsDataMap inputInfo(executable.GetInputsInfo());
+    ConstOutputsDataMap outputInfo(executable.GetOutputsInfo());
+    for (size_t i = 0; i < std::max<size_t>(size, 1); i++) {
+        std::unique_ptr<InferContext> infer_context(new InferContext());
+        InferContext* context = infer_context.get();
+        context->request = executable.CreateInferRequest();
+        context->input = context->request.GetBlob((*inputInfo.begin()).first);
+        context->output = context->request.GetBlob((*outputInfo.begin()).first);
+        context->batch_size = batch_size;
+
+        // The context is released after the owner has read its output
+        std::function<void(InferRequest, StatusCode)> callback =
+            [this, context](InferRequest, StatusCode status) {
+                context->completion(context, status);
+                this->release(context);
+            };
+        context->request.SetCompletionCallback(callback);
+
+        this->_idle_contexts.push_back(context);
+        this->_contexts.push_back(std::move(infer_context));
+    }
+}
+
+InferContext* InferRequestPool::acquire() {
+    std::unique_lock<std::mutex> lock(this->_idle_mutex);
+    this->_idle_condition.wait(lock, [this]() -> bool {
+        return !this->_idle_contexts.empty();
+    });
+
+    InferContext* context = this->_idle_contexts.back();
+    this->_idle_contexts.pop_back();
+    return context;
+}
+
+void InferRequestPool::release(InferContext* context) {
+    // Notify under the lock, the destructor may be waiting for the last context
+    std::lock_guard<std::mutex> lock(this->_idle_mutex);
+    this->_idle_contexts.push_back(context);
+    this->_idle_condition.notify_all();
+}
+
+InferRequestPool::~InferRequestPool() {
+    std::unique_lock<std::mutex> lock(this->_idle_mutex);
+    this->_idle_condition.wait(lock, [this]() -> bool {
+        return this->_idle_contexts.size() == this->_contexts.size();
+    });
+}
+
+InferRequestPool::Guard::Guard(InferRequestPool* pool)
+    : _pool(pool)
+    , _context(pool->acquire()) {
+}
+
+InferContext* InferRequestPool::Guard::get() const {
+    return this->_context;
+}
+
+InferContext* InferRequestPool::Guard::operator->() const {
+    return this->_context;
+}
+
+InferRequestPool::Guard::~Guard() {
+    this->_pool->release(this->_context);
+}
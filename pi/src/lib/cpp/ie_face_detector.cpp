@@ -0,0 +1,106 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <map>
+#include <string>
+#include <stdexcept>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "ie_face_detector.hpp"
+
+IEFaceDetector::IEFaceDetector(
+    const std::string xml,
+    const std::string bin,
+    const std::string device,
+    const DetectorOptions& options
+)
+    : _core(shared_core())
+    , _options(options) {
+    using namespace InferenceEngine;
+
+    const std::map<std::string, std::string> config;
+    this->_executable = load_cached_network(
+        *this->_core, options.cache_dir, "ie_face_detector", xml, bin, device, config, "",
+        [&]() -> ExecutableNetwork {
+            CNNNetReader networkReader;
+            networkReader.ReadNetwork(xml);
+            networkReader.ReadWeights(bin);
+            CNNNetwork network = networkReader.getNetwork();
+            network.setBatchSize(1);
+
+            // Frames are resized straight into the U8 NHWC input
+            InputsDataMap inputInfo(network.getInputsInfo());
+            InputInfo::Ptr input = (*inputInfo.begin()).second;
+            input->setPrecision(Precision::U8);
+            input->setLayout(Layout::NHWC);
+
+            OutputsDataMap outputInfo(network.getOutputsInfo());
+            (*outputInfo.begin()).second->setPrecision(Precision::FP32);
+
+            return this->_core->LoadNetwork(network, device, config);
+        }
+    );
+
+    ConstOutputsDataMap outputInfo(this->_executable.GetOutputsInfo());
+    const SizeVector& dims = (*outputInfo.begin()).second->getTensorDesc().getDims();
+    if (dims.size() != 4 || dims[3] != 7) {
+        throw std::runtime_error("Face detector " + xml + " has no SSD detection output");
+    }
+
+    this->_pool.reset(new InferRequestPool(this->_executable, options.infer_requests, 1));
+}
+
+void IEFaceDetector::detect(const cv::Mat& frame, std::vector<cv::Rect>& faces) {
+    faces.clear();
+
+    InferRequestPool::Guard context(this->_pool.get());
+
+    // Dimensions are always in NCHW order regardless of the layout
+    const InferenceEngine::SizeVector& input_dims = context->input->getTensorDesc().getDims();
+    const cv::Size input_size = cv::Size(int(input_dims[3]), int(input_dims[2]));
+    cv::Mat input(input_size, CV_8UC3, context->input->buffer().as<uint8_t*>());
+    if (frame.channels() == 1) {
+        // The buffer is reused by next calls in the same thread
+        static thread_local cv::Mat resized;
+        cv::resize(frame, resized, input_size);
+        cv::cvtColor(resized, input, cv::COLOR_GRAY2BGR);
+    } else {
+        cv::resize(frame, input, input_size);
+    }
+
+    context->request.Infer();
+
+    const InferenceEngine::SizeVector& output_dims = context->output->getTensorDesc().getDims();
+    const float* detections = context->output->buffer().as<float*>();
+    const cv::Rect bounds(0, 0, frame.cols, frame.rows);
+    for (size_t i = 0; i < output_dims[2]; i++) {
+        const float* detection = detections + i * 7;
+        // Negative image id marks the end of detections
+        if (detection[0] < 0) {
+            break;
+        }
+
+        if (detection[2] < this->_options.confidence) {
+            continue;
+        }
+
+        const cv::Rect face = bounds & cv::Rect(
+            cv::Point(int(detection[3] * frame.cols), int(detection[4] * frame.rows)),
+            cv::Point(int(detection[5] * frame.cols), int(detection[6] * frame.rows))
+        );
+        if (face.width >= this->_options.min_face_size.width && face.height >= this->_options.min_face_size.height) {
+            faces.push_back(face);
+        }
+    }
+}
+
+IEFaceDetector::~IEFaceDetector() {
+    this->_pool.reset();
+
+    // Reset executable network before plugin
+    this->_executable.reset(nullptr);
+}
@@ -5,100 +5,299 @@
     Year: 2019
 */
 
+#include <map>
 #include <string>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
 #include <opencv2/imgproc/imgproc.hpp>
 
 #include "ie_facenet_v1.hpp"
+#include "preprocessing.hpp"
 
-IEFacenet_V1::IEFacenet_V1(const std::string xml, const std::string bin, const std::string device) {
-    using namespace InferenceEngine; 
+InferenceEngine::ExecutableNetwork IEFacenet_V1::load_network(
+    const std::string& xml,
+    const std::string& bin,
+    const std::string& device,
+    const std::map<std::string, std::string>& config
+) {
+    using namespace InferenceEngine;
 
-    Core ie;
     // Reading a network
     CNNNetReader networkReader;
     networkReader.ReadNetwork(xml);
     networkReader.ReadWeights(bin);
 
-    this->_network = networkReader.getNetwork();
-    this->_network.setBatchSize(1);
+    CNNNetwork network = networkReader.getNetwork();
+    network.setBatchSize(this->_max_batch_size);
 
     // Get information about topology
-    InputsDataMap inputInfo(this->_network.getInputsInfo());
-    OutputsDataMap outputInfo(this->_network.getOutputsInfo());
+    InputsDataMap inputInfo(network.getInputsInfo());
+    InputInfo::Ptr input = (*inputInfo.begin()).second;
+    if (this->_preprocessing == PreprocessingType::Engine_Preprocessing) {
+        // The engine converts U8 NHWC input to normalized planar floats itself
+        input->setPrecision(Precision::U8);
+        input->setLayout(Layout::NHWC);
+        PreProcessInfo& preProcess = input->getPreProcess();
+        preProcess.init(3);
+        for (size_t ch = 0; ch < 3; ch++) {
+            preProcess[ch]->meanValue = 127.5f;
+            preProcess[ch]->stdScale = 128.f;
+        }
+        preProcess.setVariant(MeanVariant::MEAN_VALUE);
 
-    this->_executable = ie.LoadNetwork(this->_network, device);
-    this->_infer_request = this->_executable.CreateInferRequest();
-    this->_input = this->_infer_request.GetBlob((*inputInfo.begin()).first);
-    this->_output = this->_infer_request.GetBlob((*outputInfo.begin()).first);
+        try {
+            return this->_core->LoadNetwork(network, device, config);
+        } catch (const std::exception&) {
+            // The device doesn't support it, fall back to host preprocessing
+            input->setPrecision(Precision::FP32);
+            input->setLayout(Layout::NCHW);
+            preProcess.setVariant(MeanVariant::NONE);
+        }
+    }
+
+    return this->_core->LoadNetwork(network, device, config);
+}
+
+IEFacenet_V1::IEFacenet_V1(
+    const std::string xml,
+    const std::string bin,
+    const std::string device,
+    const ClassifierOptions& options
+)
+    : _core(shared_core())
+    , _max_batch_size(std::max<size_t>(options.max_batch_size, 1))
+    , _descriptor_size(0)
+    , _cosine(nullptr)
+    , _dot(nullptr)
+    , _dynamic_batch(false)
+    , _preprocessing(options.preprocessing) {
+    using namespace InferenceEngine; 
+
+    std::map<std::string, std::string> config;
+    if (device != std::string("CPU")) {
+        // Only CPU plugin supports dynamic batching
+        // Other devices always process the full batch, so a single face would pay for all of them
+        this->_max_batch_size = 1;
+    } else {
+        if (this->_max_batch_size > 1) {
+            config[PluginConfigParams::KEY_DYN_BATCH_ENABLED] = PluginConfigParams::YES;
+            this->_dynamic_batch = true;
+        }
+
+        if (options.cpu_streams < 0) {
+            config[PluginConfigParams::KEY_CPU_THROUGHPUT_STREAMS] = PluginConfigParams::CPU_THROUGHPUT_AUTO;
+        } else if (options.cpu_streams > 0) {
+            config[PluginConfigParams::KEY_CPU_THROUGHPUT_STREAMS] = std::to_string(options.cpu_streams);
+        }
+
+        if (options.cpu_threads > 0) {
+            config[PluginConfigParams::KEY_CPU_THREADS_NUM] = std::to_string(options.cpu_threads);
+        }
+
+        config[PluginConfigParams::KEY_CPU_BIND_THREAD] =
+            options.cpu_bind_thread ? PluginConfigParams::YES : PluginConfigParams::NO;
+    }
+
+    const std::string configuration =
+        std::to_string(this->_max_batch_size) + ":" + std::to_string(int(this->_preprocessing));
+    this->_executable = load_cached_network(
+        *this->_core, options.cache_dir, "ie_facenet_v1", xml, bin, device, config, configuration,
+        [&]() -> ExecutableNetwork {
+            return this->load_network(xml, bin, device, config);
+        }
+    );
+
+    // The effective preprocessing is defined by the input precision of the compiled network
+    ConstInputsDataMap inputInfo(this->_executable.GetInputsInfo());
+    ConstOutputsDataMap outputInfo(this->_executable.GetOutputsInfo());
+    this->_preprocessing = (*inputInfo.begin()).second->getTensorDesc().getPrecision() == Precision::U8
+        ? PreprocessingType::Engine_Preprocessing : PreprocessingType::Host_Preprocessing;
+
+    this->_descriptor_size = (*outputInfo.begin()).second->getTensorDesc().getDims().at(1);
+    this->_cosine = distance_kernel(DistanceMetric::Cosine_Similarity, this->_descriptor_size);
+    this->_dot = distance_kernel(DistanceMetric::Dot_Product, this->_descriptor_size);
+
+    // Every call checks out its own context, so the classifier can be used from many threads
+    this->_pool.reset(new InferRequestPool(
+        this->_executable, options.infer_requests, this->_max_batch_size));
 };
 
-FaceDescriptor IEFacenet_V1::embed(const cv::Mat& face) {
-    using namespace InferenceEngine;
+void IEFacenet_V1::preprocess(const cv::Mat& face, const InferenceEngine::Blob::Ptr& input, size_t id) const {
+    // Dimensions are always in NCHW order regardless of the layout
+    const InferenceEngine::SizeVector& dims = input->getTensorDesc().getDims();
+    const size_t image_size = dims[1] * dims[2] * dims[3];
+    const cv::Size expectedImageSize = cv::Size(int(dims[3]), int(dims[2]));
 
-    const cv::Size expectedImageSize = cv::Size(160, 160);
+    // The buffer is reused by next calls in the same thread
+    static thread_local cv::Mat resizedFace;
+    const cv::Mat* source = &face;
     if (face.size() != expectedImageSize) {
-        cv::resize(face, face, expectedImageSize);
+        cv::resize(face, resizedFace, expectedImageSize);
+        source = &resizedFace;
     }
 
-    cv::Mat floatFace;
-    cv::cvtColor(face, floatFace, cv::COLOR_BGR2RGB);
-    floatFace.convertTo(floatFace, CV_32FC3);
-
-    // Prepare data
-    auto data =
-        this->_input->buffer().as<float*>();
-    size_t num_channels = this->_input->getTensorDesc().getDims()[1];
-    size_t width = this->_input->getTensorDesc().getDims()[2];
-    size_t height = this->_input->getTensorDesc().getDims()[3];
-    size_t image_size = width * height;
-
-    for (size_t h = 0; h < height; h++) {
-        for (size_t w = 0; w < width; w++) {
-            for (size_t ch = 0; ch < num_channels; ch++) {
-                data[ch * image_size + h * width + w] =
-                    (floatFace.at<cv::Vec3f>(h, w)[num_channels + ch] - 127.5) / 128.0;
-            }
-        }
+    if (this->_preprocessing == PreprocessingType::Engine_Preprocessing) {
+        // Write the image directly into the NHWC blob, the network expects RGB
+        uint8_t* data = input->buffer().as<uint8_t*>() + id * image_size;
+        cv::Mat destination(expectedImageSize, CV_8UC3, data);
+        cv::cvtColor(*source, destination, cv::COLOR_BGR2RGB);
+    } else {
+        float* data = input->buffer().as<float*>() + id * image_size;
+        bgr_to_planar_rgb(*source, data);
+    }
+}
+
+void IEFacenet_V1::set_batch_size(InferContext* context, size_t batch_size) const {
+    if (!this->_dynamic_batch || batch_size == context->batch_size) {
+        return;
     }
 
-    this->_infer_request.Infer();
+    context->request.SetBatch(int(batch_size));
+    context->batch_size = batch_size;
+}
+
+FaceDescriptor IEFacenet_V1::embed(const cv::Mat& face) {
+    InferRequestPool::Guard context(this->_pool.get());
+    this->set_batch_size(context.get(), 1);
+    this->preprocess(face, context->input, 0);
+    context->request.Infer();
 
-    // get output
-    const auto output_data = this->_output->buffer().as<float *>();
-    size_t descriptor_size = this->_output->getTensorDesc().getDims().at(1);
+    const float* output_data = context->output->buffer().as<float *>();
+    return FaceDescriptor(output_data, output_data + this->_descriptor_size);
+};
 
-    std::vector<float> result;
-    result.reserve(descriptor_size);
+std::vector<FaceDescriptor> IEFacenet_V1::embed_batch(const std::vector<cv::Mat>& faces) {
+    std::vector<float> descriptors(faces.size() * this->_descriptor_size);
+    this->embed_batch(faces.data(), faces.size(), descriptors.data());
 
-    for (size_t id = 0; id < descriptor_size; id++) {
-        result.push_back(output_data[id]);
+    std::vector<FaceDescriptor> result;
+    result.reserve(faces.size());
+    for (size_t id = 0; id < faces.size(); id++) {
+        const float* descriptor = descriptors.data() + id * this->_descriptor_size;
+        result.emplace_back(descriptor, descriptor + this->_descriptor_size);
     }
 
-    return std::move(result);
+    return result;
 };
 
+void IEFacenet_V1::embed_batch(const cv::Mat* faces, size_t count, float* descriptors) {
+    if (!count) {
+        return;
+    }
+
+    InferRequestPool::Guard context(this->_pool.get());
+    const float* output_data = context->output->buffer().as<float *>();
+
+    // Faces are split into chunks of max_batch_size, one inference per chunk
+    for (size_t first = 0; first < count; first += this->_max_batch_size) {
+        const size_t batch_size = std::min(this->_max_batch_size, count - first);
+        this->set_batch_size(context.get(), batch_size);
+
+        for (size_t id = 0; id < batch_size; id++) {
+            this->preprocess(faces[first + id], context->input, id);
+        }
+
+        context->request.Infer();
+
+        memcpy(
+            descriptors + first * this->_descriptor_size,
+            output_data,
+            batch_size * this->_descriptor_size * sizeof(float)
+        );
+    }
+};
+
+size_t IEFacenet_V1::descriptor_size() const {
+    return this->_descriptor_size;
+}
+
+std::future<FaceDescriptor> IEFacenet_V1::embed_async(const cv::Mat& face) {
+    // Preprocessing is done in the caller thread
+    // so it overlaps with inference of the previous faces
+    InferContext* context = this->_pool->acquire();
+    try {
+        this->set_batch_size(context, 1);
+        this->preprocess(face, context->input, 0);
+
+        std::shared_ptr<std::promise<FaceDescriptor>> promise = std::make_shared<std::promise<FaceDescriptor>>();
+        context->completion = [this, promise](InferContext* context, InferenceEngine::StatusCode status) {
+            try {
+                if (status != InferenceEngine::StatusCode::OK) {
+                    throw std::runtime_error("Asynchronous inference failed with status " + std::to_string(status));
+                }
+
+                const float* output_data = context->output->buffer().as<float *>();
+                promise->set_value(FaceDescriptor(output_data, output_data + this->_descriptor_size));
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        };
+
+        std::future<FaceDescriptor> result = promise->get_future();
+        context->request.StartAsync();
+        return result;
+    } catch (...) {
+        this->_pool->release(context);
+        throw;
+    }
+}
+
+PreprocessingType IEFacenet_V1::preprocessing() const {
+    return this->_preprocessing;
+}
+
 float IEFacenet_V1::distance(const FaceDescriptor& desc1, const FaceDescriptor& desc2) {
     if (desc1.size() != desc2.size()) {
         throw std::invalid_argument("Both vectors must have the same size");
     }
 
+    // Descriptors of this network use the kernel chosen on load
     const size_t size = desc1.size();
-    float dot = 0;
-    float norm1 = 0;
-    float norm2 = 0;
-
-    for (size_t i = 0; i < size; i++) {
-        dot += desc1[i] * desc2[i];
-        norm1 += std::pow(desc1[i], 2);
-        norm2 += std::pow(desc2[i], 2);
-    }
+    const DistanceKernel cosine = size == this->_descriptor_size
+        ? this->_cosine : distance_kernel(DistanceMetric::Cosine_Similarity, size);
+    const float similarity = cosine(desc1.data(), desc2.data(), size);
 
-    float similarity = dot / (std::sqrt(norm1) * std::sqrt(norm2));
-
-    return std::acos(similarity);
+    // Rounding may put the similarity slightly out of the acos domain
+    return std::acos(std::min(std::max(similarity, -1.f), 1.f));
 };
 
+void IEFacenet_V1::distance_matrix(
+    const float* first,
+    size_t first_count,
+    const float* second,
+    size_t second_count,
+    size_t size,
+    float* result
+) {
+    const DistanceKernel dot = size == this->_descriptor_size
+        ? this->_dot : distance_kernel(DistanceMetric::Dot_Product, size);
+
+    // Norms are computed once per descriptor, the buffer is reused by next calls in the same thread
+    static thread_local std::vector<float> norms;
+    norms.resize(first_count + second_count);
+    for (size_t i = 0; i < first_count; i++) {
+        const float* descriptor = first + i * size;
+        norms[i] = std::sqrt(dot(descriptor, descriptor, size));
+    }
+    for (size_t j = 0; j < second_count; j++) {
+        const float* descriptor = second + j * size;
+        norms[first_count + j] = std::sqrt(dot(descriptor, descriptor, size));
+    }
+
+    for (size_t i = 0; i < first_count; i++) {
+        for (size_t j = 0; j < second_count; j++) {
+            const float norm = norms[i] * norms[first_count + j];
+            const float similarity = norm > 0.f ? dot(first + i * size, second + j * size, size) / norm : 0.f;
+            result[i * second_count + j] = std::acos(std::min(std::max(similarity, -1.f), 1.f));
+        }
+    }
+}
+
 IEFacenet_V1::~IEFacenet_V1() {
+    // Wait for running asynchronous requests
+    this->_pool.reset();
+
     // Reset executable network before plugin
     // There is segmentation fault if plugin had released before
     this->_executable.reset(nullptr);
@@ -0,0 +1,68 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "preprocessing.hpp"
+
+static const float SCALE = 1.f / 128.f;
+static const float SHIFT = -127.5f / 128.f;
+
+#if CV_SIMD128
+// Expands 16 bytes into 16 normalized floats
+static inline void store_normalized(
+    const cv::v_uint8x16& source,
+    const cv::v_float32x4& scale,
+    const cv::v_float32x4& shift,
+    float* destination
+) {
+    cv::v_uint16x8 low, high;
+    cv::v_expand(source, low, high);
+
+    cv::v_uint32x4 part1, part2, part3, part4;
+    cv::v_expand(low, part1, part2);
+    cv::v_expand(high, part3, part4);
+
+    cv::v_store(destination, cv::v_muladd(cv::v_cvt_f32(cv::v_reinterpret_as_s32(part1)), scale, shift));
+    cv::v_store(destination + 4, cv::v_muladd(cv::v_cvt_f32(cv::v_reinterpret_as_s32(part2)), scale, shift));
+    cv::v_store(destination + 8, cv::v_muladd(cv::v_cvt_f32(cv::v_reinterpret_as_s32(part3)), scale, shift));
+    cv::v_store(destination + 12, cv::v_muladd(cv::v_cvt_f32(cv::v_reinterpret_as_s32(part4)), scale, shift));
+}
+#endif
+
+void bgr_to_planar_rgb(const cv::Mat& image, float* destination) {
+    CV_Assert(image.type() == CV_8UC3);
+
+    const size_t plane_size = image.total();
+    float* red = destination;
+    float* green = destination + plane_size;
+    float* blue = destination + 2 * plane_size;
+
+    for (int y = 0; y < image.rows; y++) {
+        const uchar* row = image.ptr<uchar>(y);
+        const size_t offset = size_t(y) * image.cols;
+        int x = 0;
+
+#if CV_SIMD128
+        const cv::v_float32x4 scale = cv::v_setall_f32(SCALE);
+        const cv::v_float32x4 shift = cv::v_setall_f32(SHIFT);
+        for (; x <= image.cols - 16; x += 16) {
+            cv::v_uint8x16 b, g, r;
+            cv::v_load_deinterleave(row + x * 3, b, g, r);
+            store_normalized(r, scale, shift, red + offset + x);
+            store_normalized(g, scale, shift, green + offset + x);
+            store_normalized(b, scale, shift, blue + offset + x);
+        }
+#endif
+
+        for (; x < image.cols; x++) {
+            blue[offset + x] = row[x * 3] * SCALE + SHIFT;
+            green[offset + x] = row[x * 3 + 1] * SCALE + SHIFT;
+            red[offset + x] = row[x * 3 + 2] * SCALE + SHIFT;
+        }
+    }
+}
@@ -0,0 +1,119 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <stdexcept>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "recognition_pipeline.hpp"
+#include "roi_face_detector.hpp"
+
+RecognitionPipeline::RecognitionPipeline(
+    std::shared_ptr<Classifier> classifier,
+    std::shared_ptr<FaceDetector> detector,
+    FaceMatcher matcher,
+    RecognitionCallback callback,
+    const PipelineOptions& options
+)
+    : _classifier(classifier)
+    , _detector(detector)
+    , _matcher(matcher)
+    , _callback(callback)
+    , _options(options)
+    , _reported_dropped(0)
+    , _stages(options.queue_size) {
+    if (!this->_classifier || !this->_detector || !this->_matcher || !this->_callback) {
+        throw std::invalid_argument("Pipeline requires a classifier, a detector, a matcher and a callback");
+    }
+
+    // Only the detection thread calls the detector, so it may keep the stream state
+    if (options.roi_refresh_frames) {
+        RoiOptions roi_options;
+        roi_options.refresh_frames = options.roi_refresh_frames;
+        this->_detector = std::make_shared<RoiFaceDetector>(this->_detector, roi_options);
+    }
+
+    using namespace std::placeholders;
+    this->_stages.add_stage("detect", std::bind(&RecognitionPipeline::detect, this, _1));
+    this->_stages.add_stage("embed", std::bind(&RecognitionPipeline::embed, this, _1));
+    this->_stages.add_stage("match", std::bind(&RecognitionPipeline::match, this, _1));
+    this->_stages.start();
+}
+
+bool RecognitionPipeline::push(const cv::Mat& frame, FrameFormat format, int64_t timestamp) {
+    const bool expected_type = format == FrameFormat::BGR_Frame
+        ? frame.type() == CV_8UC3 : frame.type() == CV_8UC1 && frame.rows % 3 == 0;
+    if (frame.empty() || !expected_type) {
+        throw std::invalid_argument("Frame doesn't match its format");
+    }
+
+    FramePacket packet;
+    packet.timestamp = timestamp;
+    packet.format = format;
+    packet.frame = frame.clone();
+    return this->_stages.push(std::move(packet));
+}
+
+size_t RecognitionPipeline::dropped() const {
+    return this->_stages.dropped();
+}
+
+std::vector<StageStatistics> RecognitionPipeline::statistics() const {
+    return this->_stages.statistics();
+}
+
+bool RecognitionPipeline::detect(FramePacket& packet) {
+    if (packet.format != FrameFormat::BGR_Frame) {
+        cv::Mat bgr;
+        cv::cvtColor(
+            packet.frame,
+            bgr,
+            packet.format == FrameFormat::NV12_Frame ? cv::COLOR_YUV2BGR_NV12 : cv::COLOR_YUV2BGR_I420
+        );
+        packet.frame = bgr;
+        packet.format = FrameFormat::BGR_Frame;
+    }
+
+    this->_detector->detect(packet.frame, packet.faces);
+    return true;
+}
+
+bool RecognitionPipeline::embed(FramePacket& packet) {
+    // Faces are read from the frame in place
+    static thread_local std::vector<cv::Mat> faces;
+    faces.clear();
+    for (const cv::Rect& face: packet.faces) {
+        faces.push_back(packet.frame(face));
+    }
+
+    packet.descriptors.resize(faces.size() * this->_classifier->descriptor_size());
+    this->_classifier->embed_batch(faces.data(), faces.size(), packet.descriptors.data());
+    return true;
+}
+
+bool RecognitionPipeline::match(FramePacket& packet) {
+    const size_t descriptor_size = this->_classifier->descriptor_size();
+    static thread_local RecognitionResult result;
+    result.timestamp = packet.timestamp;
+    result.faces.clear();
+    for (size_t i = 0; i < packet.faces.size(); i++) {
+        GalleryMatch best = {0, 0.f};
+        const bool identified = this->_matcher(
+            packet.descriptors.data() + i * descriptor_size, this->_options.threshold, best);
+        result.faces.push_back({packet.faces[i], identified, best.id, best.distance});
+    }
+
+    // Only this stage touches the reported counter
+    const size_t dropped = this->_stages.dropped();
+    result.dropped_frames = dropped - this->_reported_dropped;
+    this->_reported_dropped = dropped;
+    this->_callback(result);
+    return true;
+}
+
+RecognitionPipeline::~RecognitionPipeline() {
+    this->_stages.stop();
+}
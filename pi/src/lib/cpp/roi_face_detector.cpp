@@ -0,0 +1,69 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <stdexcept>
+
+#include "roi_face_detector.hpp"
+
+RoiFaceDetector::RoiFaceDetector(std::shared_ptr<FaceDetector> detector, const RoiOptions& options)
+    : _detector(detector)
+    , _options(options)
+    , _since_full(0) {
+    if (!this->_detector) {
+        throw std::invalid_argument("ROI detector requires a detector");
+    }
+}
+
+void RoiFaceDetector::detect(const cv::Mat& frame, std::vector<cv::Rect>& faces) {
+    const cv::Rect bounds(0, 0, frame.cols, frame.rows);
+    const bool full = this->_known.empty()
+        || !this->_options.refresh_frames
+        || this->_since_full >= this->_options.refresh_frames
+        || frame.size() != this->_frame_size;
+
+    if (full) {
+        this->_detector->detect(frame, faces);
+        this->_since_full = 0;
+    } else {
+        // Regions around known faces, overlapping ones are merged so a face is found once
+        std::vector<cv::Rect> regions;
+        for (const cv::Rect& face: this->_known) {
+            const int dx = int(face.width * this->_options.margin);
+            const int dy = int(face.height * this->_options.margin);
+            cv::Rect region = cv::Rect(face.x - dx, face.y - dy, face.width + 2 * dx, face.height + 2 * dy) & bounds;
+            for (size_t i = 0; i < regions.size();) {
+                if ((region & regions[i]).area() > 0) {
+                    region |= regions[i];
+                    regions.erase(regions.begin() + i);
+                    i = 0;
+                } else {
+                    i++;
+                }
+            }
+            regions.push_back(region);
+        }
+
+        // Crops are views of the frame, so nothing is copied
+        static thread_local std::vector<cv::Rect> found;
+        faces.clear();
+        for (const cv::Rect& region: regions) {
+            this->_detector->detect(frame(region), found);
+            for (const cv::Rect& face: found) {
+                faces.push_back(face + region.tl());
+            }
+        }
+    }
+
+    // Lost faces make the next frame a full one
+    this->_known = faces;
+    this->_frame_size = frame.size();
+    this->_since_full++;
+}
+
+void RoiFaceDetector::reset() {
+    this->_known.clear();
+}
@@ -0,0 +1,318 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+#include "staged_pipeline.hpp"
+#include "ring_buffer.hpp"
+
+// Latency histogram: exact below 8 ns, then 8 buckets per power of two
+static const size_t LATENCY_SUB_BUCKETS = 8;
+static const size_t LATENCY_BUCKETS = 62 * LATENCY_SUB_BUCKETS;
+
+static size_t latency_bucket(uint64_t ns) {
+    if (ns < LATENCY_SUB_BUCKETS) {
+        return size_t(ns);
+    }
+
+    // The leading bit selects the octave, the next three bits the bucket in it
+    const size_t exponent = 63 - __builtin_clzll(ns);
+    const size_t mantissa = (ns >> (exponent - 3)) & (LATENCY_SUB_BUCKETS - 1);
+    return (exponent - 2) * LATENCY_SUB_BUCKETS + mantissa;
+}
+
+// Middle of the bucket in nanoseconds
+static double latency_value(size_t bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return double(bucket);
+    }
+
+    const size_t exponent = bucket / LATENCY_SUB_BUCKETS + 2;
+    const size_t mantissa = bucket % LATENCY_SUB_BUCKETS;
+    return (LATENCY_SUB_BUCKETS + mantissa + 0.5) * double(uint64_t(1) << (exponent - 3));
+}
+
+struct PipelineStage {
+    std::string name;
+    StageFunction function;
+    std::thread thread;
+    std::atomic<size_t> processed;
+    std::atomic<size_t> discarded;
+    std::atomic<size_t> dropped;
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> total_ns;
+    std::atomic<uint64_t> max_ns;
+    std::atomic<uint32_t> latencies[LATENCY_BUCKETS];
+
+    PipelineStage(const std::string& name, StageFunction function)
+        : name(name)
+        , function(function)
+        , processed(0)
+        , discarded(0)
+        , dropped(0)
+        , calls(0)
+        , total_ns(0)
+        , max_ns(0) {
+        for (std::atomic<uint32_t>& bucket: this->latencies) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Returns true if the packet has to be passed on
+    bool process(FramePacket& packet) {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool passed = false;
+        try {
+            passed = this->function(packet);
+            (passed ? this->processed : this->discarded)++;
+        } catch (const std::exception&) {
+            this->dropped++;
+        }
+
+        // Only the stage thread writes its timings
+        const uint64_t elapsed = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        this->calls++;
+        this->total_ns += elapsed;
+        if (elapsed > this->max_ns.load(std::memory_order_relaxed)) {
+            this->max_ns = elapsed;
+        }
+        this->latencies[latency_bucket(elapsed)].fetch_add(1, std::memory_order_relaxed);
+
+        return passed;
+    }
+
+    // Latency of the given fraction of calls in milliseconds
+    double percentile(const uint32_t* counts, uint64_t total, double fraction) const {
+        const uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(fraction * total)));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+            seen += counts[bucket];
+            if (seen >= rank) {
+                return latency_value(bucket) / 1e6;
+            }
+        }
+
+        return 0.;
+    }
+
+    StageStatistics statistics() const {
+        const uint64_t calls = this->calls;
+        // The stage may be running, so percentiles are taken from a copy of the histogram
+        uint32_t counts[LATENCY_BUCKETS];
+        uint64_t total = 0;
+        for (size_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+            counts[bucket] = this->latencies[bucket].load(std::memory_order_relaxed);
+            total += counts[bucket];
+        }
+
+        return {
+            this->name,
+            this->processed,
+            this->discarded,
+            this->dropped,
+            calls ? double(this->total_ns) / calls / 1e6 : 0.,
+            total ? this->percentile(counts, total, 0.50) : 0.,
+            total ? this->percentile(counts, total, 0.95) : 0.,
+            total ? this->percentile(counts, total, 0.99) : 0.,
+            double(this->max_ns) / 1e6
+        };
+    }
+};
+
+StagedPipeline::StagedPipeline(size_t queue_depth, bool output, bool lossless)
+    : _queue_depth(queue_depth ? queue_depth : 1)
+    , _output(output)
+    , _lossless(lossless)
+    , _started(false)
+    , _stopped(false)
+    , _stopping(false)
+    , _next_index(0) {
+}
+
+void StagedPipeline::set_source(const std::string& name, StageFunction function) {
+    if (this->_started) {
+        throw std::logic_error("Source can't be changed after start");
+    }
+
+    this->_source.reset(new PipelineStage(name, function));
+}
+
+void StagedPipeline::add_stage(const std::string& name, StageFunction function) {
+    if (this->_started) {
+        throw std::logic_error("Stages can't be added after start");
+    }
+
+    this->_stages.emplace_back(new PipelineStage(name, function));
+}
+
+void StagedPipeline::start() {
+    if (this->_started) {
+        throw std::logic_error("Pipeline is already started");
+    }
+
+    const size_t queues = this->_stages.size() + (this->_output ? 1 : 0);
+    for (size_t i = 0; i < queues; i++) {
+        this->_queues.emplace_back(new RingBuffer<FramePacket>(this->_queue_depth));
+    }
+
+    this->_started = true;
+    for (size_t id = 0; id < this->_stages.size(); id++) {
+        this->_stages[id]->thread = std::thread(&StagedPipeline::run_stage, this, id);
+    }
+
+    if (this->_source) {
+        this->_source->thread = std::thread(&StagedPipeline::run_source, this);
+    }
+}
+
+void StagedPipeline::run_source() {
+    RingBuffer<FramePacket>* output = this->_queues.empty() ? nullptr : this->_queues.front().get();
+    while (!this->_stopping) {
+        FramePacket packet;
+        packet.index = this->_next_index++;
+        // The stream ends when the source discards a packet, a failure costs only the packet
+        const size_t dropped = this->_source->dropped;
+        if (!this->_source->process(packet)) {
+            if (this->_source->dropped != dropped) {
+                continue;
+            }
+
+            break;
+        }
+
+        if (output) {
+            this->forward(0, packet);
+        }
+    }
+
+    if (output) {
+        output->close();
+    }
+}
+
+void StagedPipeline::count_drop(size_t queue) {
+    // Packets dropped in front of the output are counted by the last stage
+    if (queue < this->_stages.size()) {
+        this->_stages[queue]->dropped++;
+    } else if (!this->_stages.empty()) {
+        this->_stages.back()->dropped++;
+    } else if (this->_source) {
+        this->_source->dropped++;
+    }
+}
+
+bool StagedPipeline::forward(size_t queue, FramePacket& packet) {
+    RingBuffer<FramePacket>& output = *this->_queues[queue];
+    // Nobody may pop the output after stop(), so a lossless pipeline starts dropping then
+    if (this->_lossless) {
+        for (size_t attempt = 0; !this->_stopping; attempt++) {
+            if (output.try_push(packet)) {
+                return true;
+            }
+
+            RingBuffer<FramePacket>::backoff(attempt);
+        }
+    }
+
+    if (!output.push(std::move(packet))) {
+        this->count_drop(queue);
+        return false;
+    }
+
+    return true;
+}
+
+void StagedPipeline::run_stage(size_t id) {
+    RingBuffer<FramePacket>& input = *this->_queues[id];
+    RingBuffer<FramePacket>* output = id + 1 < this->_queues.size() ? this->_queues[id + 1].get() : nullptr;
+    PipelineStage& stage = *this->_stages[id];
+
+    FramePacket packet;
+    while (input.pop(packet)) {
+        if (!stage.process(packet) || !output) {
+            continue;
+        }
+
+        this->forward(id + 1, packet);
+    }
+
+    if (output) {
+        output->close();
+    }
+}
+
+bool StagedPipeline::push(FramePacket packet) {
+    if (!this->_started || this->_stopping || this->_source) {
+        throw std::logic_error("Pipeline doesn't accept packets");
+    }
+
+    if (this->_queues.empty()) {
+        return true;
+    }
+
+    packet.index = this->_next_index++;
+    return this->forward(0, packet);
+}
+
+bool StagedPipeline::pop(FramePacket& packet) {
+    if (!this->_output || !this->_started) {
+        throw std::logic_error("Pipeline has no output");
+    }
+
+    return this->_queues.back()->pop(packet);
+}
+
+void StagedPipeline::stop() {
+    if (!this->_started || this->_stopped) {
+        return;
+    }
+
+    this->_stopping = true;
+    if (this->_source) {
+        this->_source->thread.join();
+    } else if (!this->_queues.empty()) {
+        this->_queues.front()->close();
+    }
+
+    // Every stage closes its output when its input is closed and empty
+    for (std::unique_ptr<PipelineStage>& stage: this->_stages) {
+        stage->thread.join();
+    }
+
+    this->_stopped = true;
+}
+
+std::vector<StageStatistics> StagedPipeline::statistics() const {
+    std::vector<StageStatistics> result;
+    if (this->_source) {
+        result.push_back(this->_source->statistics());
+    }
+
+    for (const std::unique_ptr<PipelineStage>& stage: this->_stages) {
+        result.push_back(stage->statistics());
+    }
+
+    return result;
+}
+
+size_t StagedPipeline::dropped() const {
+    size_t result = this->_source ? this->_source->dropped.load() : 0;
+    for (const std::unique_ptr<PipelineStage>& stage: this->_stages) {
+        result += stage->dropped;
+    }
+
+    return result;
+}
+
+StagedPipeline::~StagedPipeline() {
+    this->stop();
+}
@@ -0,0 +1,97 @@
+/*
+    Author: Boris Sekachev
+    Email: b.sekachev@yandex.ru
+    Organization: NNTU
+    Year: 2020
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "synced_file.hpp"
+
+std::runtime_error system_error(const std::string& message, const std::string& path) {
+    return std::runtime_error(message + " " + path + ": " + std::strerror(errno));
+}
+
+SyncedFile::SyncedFile(const std::string& path, int flags)
+    : _descriptor(open(path.c_str(), O_WRONLY | O_CREAT | flags, 0644))
+    , _offset(0)
+    , _path(path) {
+    if (this->_descriptor < 0) {
+        throw system_error("Could not open for writing", path);
+    }
+
+    // Writes continue at the end of an existing file
+    const off_t end = lseek(this->_descriptor, 0, SEEK_END);
+    if (end < 0) {
+        close(this->_descriptor);
+        throw system_error("Could not seek", path);
+    }
+    this->_offset = uint64_t(end);
+}
+
+void SyncedFile::write(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size) {
+        const ssize_t written = ::write(this->_descriptor, bytes, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (written <= 0) {
+            throw system_error("Could not write", this->_path);
+        }
+
+        bytes += written;
+        size -= size_t(written);
+        this->_offset += uint64_t(written);
+    }
+}
+
+void SyncedFile::pad(uint64_t offset) {
+    static const char zeros[64] = {};
+    while (this->_offset < offset) {
+        this->write(zeros, size_t(std::min<uint64_t>(offset - this->_offset, sizeof(zeros))));
+    }
+}
+
+void SyncedFile::truncate(uint64_t offset) {
+    if (ftruncate(this->_descriptor, off_t(offset)) != 0 || lseek(this->_descriptor, off_t(offset), SEEK_SET) < 0) {
+        throw system_error("Could not truncate", this->_path);
+    }
+    this->_offset = offset;
+}
+
+void SyncedFile::sync() {
+    // Metadata of the file matters only when its size changes, fdatasync writes it then too
+    if (fdatasync(this->_descriptor) != 0) {
+        throw system_error("Could not sync", this->_path);
+    }
+}
+
+uint64_t SyncedFile::offset() const {
+    return this->_offset;
+}
+
+SyncedFile::~SyncedFile() {
+    close(this->_descriptor);
+}
+
+void sync_directory(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    const std::string directory = slash == std::string::npos ? std::string(".") : path.substr(0, slash + 1);
+    const int descriptor = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (descriptor < 0) {
+        throw system_error("Could not open the directory", directory);
+    }
+
+    const int result = fsync(descriptor);
+    close(descriptor);
+    if (result != 0) {
+        throw system_error("Could not sync the directory", directory);
+    }
+}
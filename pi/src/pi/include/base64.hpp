@@ -28,6 +28,8 @@
 
 */
 
+// Altered: the functions are inline, so the header can be included by several translation units
+
 static const std::string base64_chars = 
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
     "abcdefghijklmnopqrstuvwxyz"
@@ -38,7 +40,7 @@ static inline bool is_base64(unsigned char c) {
     return (isalnum(c) || (c == '+') || (c == '/'));
 }
 
-std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len) {
+inline std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len) {
     std::string ret;
     int i = 0;
     int j = 0;
@@ -78,7 +80,7 @@ std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_
 
     return ret;
 }
-std::string base64_decode(std::string const& encoded_string) {
+inline std::string base64_decode(std::string const& encoded_string) {
     int in_len = encoded_string.size();
     int i = 0;
     int j = 0;
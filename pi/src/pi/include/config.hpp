@@ -10,8 +10,21 @@ struct PIConfiguration {
     std::string devicePIN;
     std::string networkVersion;
     std::string inferenceBackend;
+    uint inferRequests;
+    std::string networkCacheDir;
+    int cpuStreams;
+    int cpuThreads;
+    bool cpuBindThread;
+    std::string faceDetector;
     std::string faceHaarCascade;
+    float detectionConfidence;
+    int minFaceSize;
+    int detectionWidth;
+    uint detectionRoiFrames;
     std::string dbFile;
+    std::string galleryFile;
+    std::string journalFile;
+    uint journalCompactRecords;
     std::string brokerHost;
     std::string brokerPort;
     uint reconnectTimeSec;
@@ -19,11 +32,23 @@ struct PIConfiguration {
     uint redDiodeGPIO;
     uint greenDiodeGPIO;
     uint hcSR501GPIO;
+    std::string gpioBackend;
+    std::string gpioScript;
+    int cameraIndex;
+    std::string cameraInput;
+    double cameraInputFps;
+    uint recognitionWindowMs;
+    float recognitionThreshold;
+    float motionThreshold;
     bool UI;
     struct {
         std::string bin;
         std::string xml;
     } network;
+    struct {
+        std::string bin;
+        std::string xml;
+    } detectorNetwork;
 };
 
 PIConfiguration initialize_config(const std::string& filename = std::string());
@@ -4,18 +4,21 @@
 #include <vector>
 #include <thread>
 
-#include <opencv2/objdetect/objdetect.hpp>
-
 #include <config.hpp>
 #include <users.hpp>
 #include <classifier.hpp>
+#include <face_detector.hpp>
+#include <gpio.hpp>
 
 extern PIConfiguration global_pi_configuration;
 extern std::vector<User> global_pi_users;
+// Incremented on every change of global_pi_users, the broker applies deltas only to the previous revision
+extern uint64_t global_pi_users_revision;
+// Hash of global_pi_users content (see users_hash), unlike the revision it survives restarts
+extern uint64_t global_pi_users_hash;
 extern std::shared_ptr<Classifier> global_pi_classifier;
-extern cv::CascadeClassifier global_pi_face_detector;
+extern std::shared_ptr<FaceDetector> global_pi_face_detector;
 extern std::mutex global_pi_users_mutex;
-extern std::mutex global_pi_classifier_mutex;
-extern std::mutex global_pi_face_detector_mutex;
+extern std::shared_ptr<GPIO> global_pi_gpio;
 
 #endif
\ No newline at end of file
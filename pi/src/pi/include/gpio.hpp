@@ -0,0 +1,28 @@
+#ifndef PI_GPIO_HPP
+#define PI_GPIO_HPP
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+// Pins of the board, PIApp doesn't call wiringPi directly
+// so it runs on the device and with simulated hardware on any machine
+class GPIO {
+    public:
+        virtual void input(unsigned int pin) = 0;
+        virtual void output(unsigned int pin) = 0;
+        virtual bool read(unsigned int pin) = 0;
+        virtual void write(unsigned int pin, bool value) = 0;
+        // Sleeps until the input pin is high, returns false if it is still low after the timeout
+        // Returns at once if the pin is already high
+        virtual bool wait_high(unsigned int pin, std::chrono::milliseconds timeout) = 0;
+        // True when inputs can't change anymore, e.g. a simulation script has ended
+        virtual bool closed() const = 0;
+        virtual ~GPIO() = default;
+};
+
+// Backends: "wiringpi" (edge interrupts of the board) and "simulated" (inputs replayed from the script)
+// Simulation script lines are "<delay ms> <pin> <0|1>", the delay is counted from the previous line
+std::shared_ptr<GPIO> build_gpio(const std::string& backend, const std::string& script = std::string());
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef PI_RECOGNITION_HPP
+#define PI_RECOGNITION_HPP
+
+#include <vector>
+
+#include <users.hpp>
+
+// Maps the gallery file of known faces, replays the journal over it and reads the users
+// The caller holds global_pi_users_mutex, a missing gallery file is converted from the JSON users first
+void load_gallery(std::vector<User>& users);
+
+// Adds the user to global_pi_users, the gallery and the journal, the caller holds global_pi_users_mutex
+// Throws std::runtime_error if a user with the id exists
+// The journal is compacted into the gallery file in the background once it is long enough
+void enroll_user(const User& user);
+
+// Removes the user from global_pi_users, the gallery and the journal, the caller holds global_pi_users_mutex
+// Returns false if there is no such user
+bool remove_user(unsigned int id);
+
+// Copies the descriptor of the user stored in the gallery, it is L2-normalized
+// Returns false if the gallery has no such user
+bool stored_descriptor(unsigned int id, std::vector<float>& descriptor);
+
+// Waits for the running compaction
+void close_gallery();
+
+// Opens the camera and recognizes faces while there is motion in front of it
+// Frames are passed to the pipeline only if they differ from the previous passed one
+// Returns when neither the sensor nor the camera has seen motion for the recognition window
+void recognize_motion();
+
+#endif
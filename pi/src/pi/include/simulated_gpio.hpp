@@ -0,0 +1,44 @@
+#ifndef PI_SIMULATED_GPIO_HPP
+#define PI_SIMULATED_GPIO_HPP
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+#include <gpio.hpp>
+
+// Inputs are replayed from a script in a background thread, outputs are printed
+class SimulatedGPIO: public GPIO {
+    private:
+        struct Event {
+            std::chrono::milliseconds delay;
+            unsigned int pin;
+            bool value;
+        };
+
+        std::vector<Event> _events;
+        std::map<unsigned int, bool> _pins;
+        bool _closed;
+        bool _stopping;
+        mutable std::mutex _mutex;
+        std::condition_variable _changed;
+        std::thread _player;
+
+        void play();
+    public:
+        SimulatedGPIO(const std::string& script);
+        SimulatedGPIO(const SimulatedGPIO&) = delete;
+        SimulatedGPIO& operator=(const SimulatedGPIO&) = delete;
+
+        void input(unsigned int pin) override;
+        void output(unsigned int pin) override;
+        bool read(unsigned int pin) override;
+        void write(unsigned int pin, bool value) override;
+        bool wait_high(unsigned int pin, std::chrono::milliseconds timeout) override;
+        bool closed() const override;
+        ~SimulatedGPIO() override;
+};
+
+#endif
@@ -1,12 +1,30 @@
 #ifndef PI_USERS_HPP
 #define PI_USERS_HPP
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <json.hpp>
 
+#include <gallery_file.hpp>
+
 using nlohmann::json;
 
+// Encoding of descriptors in JSON, its number is written as descriptorVersion next to the users
+// A missing version means the arrays every reader understands
+enum class DescriptorEncoding {
+    // Array of numbers, about 10 characters per float
+    JSON_Array = 1,
+    // Base64 string of little-endian float32, 5.3 characters per float
+    Base64_Float32 = 2,
+    // Base64 string of little-endian IEEE half floats, 2.7 characters per float,
+    // the relative precision is about 5e-4, enough for distances of normalized descriptors
+    Base64_Float16 = 3
+};
+
+// Returns the encoding of the descriptorVersion field, throws std::runtime_error for an unknown one
+DescriptorEncoding descriptor_encoding(const json& version);
+
 class User {
     private:
         unsigned int _id = 0;
@@ -18,12 +36,55 @@ class User {
     public:
         User();
         void embed(const std::vector<float> descriptor);
-        json toJSON() const;
-        void parseJSON(const json& source);
+        unsigned int id() const;
+        std::string name() const;
+        const std::vector<float>& descriptor() const;
+        // The descriptor is written only if it is requested and the user holds one
+        json toJSON(bool withDescriptor = true, DescriptorEncoding encoding = DescriptorEncoding::JSON_Array) const;
+        void parseJSON(const json& source, DescriptorEncoding encoding = DescriptorEncoding::JSON_Array);
+        // Fields without the descriptor, the gallery file keeps descriptors separately
+        std::string toMetadata() const;
+        void parseMetadata(unsigned int id, const std::string& metadata);
+        // Hash of the id and the fields, the hash of a user list is the sum of the user hashes,
+        // so it is updated per change and doesn't depend on the order
+        uint64_t hash() const;
         ~User();
 };
 
+// Returns the next id of a new user, a non-zero bound makes next ids greater than it
+unsigned int id_generator(unsigned int initial_low_bound = 0);
+
 std::vector<User> read_users(const std::string& filename, const std::string& networkVersion);
-void update_users(const std::vector<User>& users, const std::string& filename, const std::string& networkVersion);
+uint64_t users_hash(const std::vector<User>& users);
+void update_users(
+    const std::vector<User>& users,
+    const std::string& filename,
+    const std::string& networkVersion,
+    DescriptorEncoding encoding = DescriptorEncoding::JSON_Array
+);
+
+// Maps the binary gallery and reads its users, descriptors stay in the file
+// Returns nullptr if the file can't be mapped or belongs to another network
+std::unique_ptr<MappedGallery> read_gallery(
+    const std::string& filename,
+    const std::string& networkVersion,
+    std::vector<User>& users
+);
+// Writes the gallery with the metadata of the users, the old file is replaced atomically
+void write_gallery(
+    const std::vector<User>& users,
+    const FaceGallery& gallery,
+    const std::string& filename,
+    const std::string& networkVersion
+);
+// Converts users with descriptors from the JSON file into the gallery file
+// Users with descriptors of another size are skipped, a missing or empty file gives an empty gallery
+// of the dimension. Returns false if the JSON file can't be read or the gallery can't be written
+bool convert_users(
+    const std::string& jsonFile,
+    const std::string& galleryFile,
+    const std::string& networkVersion,
+    size_t dimension
+);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef PI_WIRINGPI_GPIO_HPP
+#define PI_WIRINGPI_GPIO_HPP
+
+#include <set>
+#include <mutex>
+#include <condition_variable>
+
+#include <gpio.hpp>
+
+// Board pins in the wiringPi numbering
+// Threads waiting for an input are woken by its edge interrupt instead of polling it
+class WiringPiGPIO: public GPIO {
+    private:
+        // wiringPi calls interrupt handlers without arguments and never removes them,
+        // so one static handler wakes all waiters and they check their pins
+        static std::mutex _mutex;
+        static std::condition_variable _edge;
+        // Inputs without an interrupt are polled
+        std::set<unsigned int> _interrupts;
+
+        static void on_edge();
+    public:
+        WiringPiGPIO();
+        WiringPiGPIO(const WiringPiGPIO&) = delete;
+        WiringPiGPIO& operator=(const WiringPiGPIO&) = delete;
+
+        void input(unsigned int pin) override;
+        void output(unsigned int pin) override;
+        bool read(unsigned int pin) override;
+        void write(unsigned int pin, bool value) override;
+        bool wait_high(unsigned int pin, std::chrono::milliseconds timeout) override;
+        bool closed() const override;
+        ~WiringPiGPIO() override;
+};
+
+#endif
@@ -1,4 +1,6 @@
 #include <string>
+#include <sstream>
+#include <iomanip>
 #include <iostream>
 #include <thread>
 
@@ -15,6 +17,7 @@
 #include <config.hpp>
 #include <broker.hpp>
 #include <globals.hpp>
+#include <recognition.hpp>
 
 using nlohmann::json;
 
@@ -25,7 +28,43 @@ namespace net = boost::asio;            // from <boost/asio.hpp>
 
 using tcp = boost::asio::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
 
+// Descriptors the broker asks for, the answer to CONNECT_PI sets them for the whole connection
+struct DescriptorRequest {
+    bool descriptors = false;
+    DescriptorEncoding encoding = DescriptorEncoding::JSON_Array;
+};
+
+static DescriptorRequest connection_descriptors;
+
+static DescriptorRequest descriptor_request(const json& payload) {
+    DescriptorRequest request;
+    if (!payload.is_object()) {
+        return request;
+    }
+
+    const json::const_iterator descriptors = payload.find("descriptors");
+    request.descriptors = descriptors != payload.end() && descriptors->is_boolean() && descriptors->get<bool>();
+    const json::const_iterator version = payload.find("descriptorVersion");
+    if (request.descriptors && version != payload.end()) {
+        try {
+            request.encoding = descriptor_encoding(*version);
+        } catch (std::exception& ex) {
+            // Users are still sent, without descriptors the broker can't read
+            std::cout << ex.what() << std::endl;
+            request.descriptors = false;
+        }
+    }
+    return request;
+}
+
 namespace messages {
+    // 64-bit numbers don't survive JavaScript numbers, so the hash is sent as a hex string
+    std::string usersHash() {
+        std::stringstream stream;
+        stream << std::hex << std::setw(16) << std::setfill('0') << global_pi_users_hash;
+        return stream.str();
+    }
+
     std::string ok(const std::string& reason) {
         json body = json::object();
         body["type"] = std::string("OK_STATUS");
@@ -50,22 +89,65 @@ namespace messages {
         body["payload"] = json::object();
         body["payload"]["pin"] = global_pi_configuration.devicePIN;
         body["payload"]["name"] = global_pi_configuration.deviceName;
+        // The broker keeps users of disconnected devices, it skips the full list if they have the same hash
+        body["payload"]["revision"] = global_pi_users_revision;
+        body["payload"]["hash"] = usersHash();
 
         return body.dump();
     }
 
-    std::string updatePIUsers() {
+    // Full user list, the broker replaces its copy with it
+    std::string updatePIUsers(const DescriptorRequest& request) {
         json body = json::object();
         body["type"] = std::string("UPDATE_PI_USERS");
         body["payload"] = json::object();
+        body["payload"]["revision"] = global_pi_users_revision;
+        body["payload"]["hash"] = usersHash();
+        if (request.descriptors) {
+            body["payload"]["descriptorVersion"] = int(request.encoding);
+        }
         body["payload"]["users"] = json::array();
 
+        // Users keep no descriptors in memory, they are taken from the gallery
+        std::vector<float> descriptor;
         for (const User& user: global_pi_users) {
-            body["payload"]["users"].push_back(user.toJSON());
+            if (request.descriptors && stored_descriptor(user.id(), descriptor)) {
+                User copy = user;
+                copy.embed(descriptor);
+                body["payload"]["users"].push_back(copy.toJSON(true, request.encoding));
+            } else {
+                body["payload"]["users"].push_back(user.toJSON(false));
+            }
         }
 
         return body.dump();
     }
+
+    // Deltas are applied by the broker only if it has the previous revision, otherwise it requests the full list
+    std::string userAdded(const User& user) {
+        json body = json::object();
+        body["type"] = std::string("USER_ADDED");
+        body["payload"] = json::object();
+        body["payload"]["revision"] = global_pi_users_revision;
+        body["payload"]["hash"] = usersHash();
+        if (connection_descriptors.descriptors) {
+            body["payload"]["descriptorVersion"] = int(connection_descriptors.encoding);
+        }
+        body["payload"]["user"] = user.toJSON(connection_descriptors.descriptors, connection_descriptors.encoding);
+
+        return body.dump();
+    }
+
+    std::string userRemoved(unsigned int id) {
+        json body = json::object();
+        body["type"] = std::string("USER_REMOVED");
+        body["payload"] = json::object();
+        body["payload"]["revision"] = global_pi_users_revision;
+        body["payload"]["hash"] = usersHash();
+        body["payload"]["userID"] = id;
+
+        return body.dump();
+    }
 }
 
 void create_user(
@@ -76,14 +158,12 @@ void create_user(
     const int size = int(decoded_image.size());
     char* data = new char[size];
     try {
-        std::lock_guard<std::mutex> detector_guard(global_pi_face_detector_mutex);
-        std::lock_guard<std::mutex> classifier_guard(global_pi_classifier_mutex);
         memcpy(data, decoded_image.c_str(), size);
         cv::Mat image = cv::imdecode(cv::Mat(1, int(decoded_image.size()), CV_8UC1, data), cv::IMREAD_COLOR);
-        cv::Mat gray, face;
+        cv::Mat face;
         std::vector<cv::Rect> faces;
-        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-        global_pi_face_detector.detectMultiScale(gray, faces, 1.5, 5, 0, cv::Size(150, 150));
+        global_pi_face_detector->detect(image, faces);
+
         if (faces.size() < 1) {
             throw std::runtime_error("Faces was not found on the image");
         }
@@ -94,23 +174,19 @@ void create_user(
 
         face = image(faces[0]);
         cv::resize(face, face, cv::Size(160, 160));
+        // The classifier is thread-safe, so enrollment runs in parallel with recognition
         payload["descriptor"] = global_pi_classifier->embed(face);
 
         std::lock_guard<std::mutex> users_guard(global_pi_users_mutex);
         User new_user;
         new_user.parseJSON(payload);
-        global_pi_users.push_back(new_user);
-        update_users(
-            global_pi_users,
-            global_pi_configuration.dbFile,
-            global_pi_configuration.networkVersion
-        );
+        enroll_user(new_user);
 
         std::string response = messages::ok(std::string("CREATE_PI_USER"));
         std::cout << "Sending " << response << std::endl;
         websocket.write(net::buffer(response));
 
-        response = messages::updatePIUsers();
+        response = messages::userAdded(new_user);
         std::cout << "Sending " << response << std::endl;
         websocket.write(net::buffer(response));
     } catch (std::exception& ex) {
@@ -132,8 +208,14 @@ void handle_message(
         && body["payload"]["for"].is_string()
     ) {
         if (body["payload"]["for"] == std::string("CONNECT_PI")) {
+            connection_descriptors = descriptor_request(body["payload"]);
+            if (body["payload"]["upToDate"].is_boolean() && body["payload"]["upToDate"].get<bool>()) {
+                std::cout << "Broker has the current users" << std::endl;
+                return;
+            }
+
             std::lock_guard<std::mutex> guard(global_pi_users_mutex);
-            const std::string response = messages::updatePIUsers();
+            const std::string response = messages::updatePIUsers(connection_descriptors);
             std::cout << "Sending " << response << std::endl;
             websocket.write(net::buffer(response));
             return;
@@ -145,7 +227,7 @@ void handle_message(
         std::cout << "Got error response status for " << body["payload"]["for"] << " request" << std::endl;
     } else if (body["type"] == std::string("CREATE_PI_USER")) {
         try {
-            std::lock_guard<std::mutex> guard(global_pi_users_mutex);
+            // The users are locked inside, after the slow embedding
             create_user(body["payload"], websocket);
         } catch (std::exception& ex) {
             std::cout << "Could not create a user" << std::endl;
@@ -153,11 +235,36 @@ void handle_message(
             std::cout << "Sending " << response << std::endl;
             websocket.write(net::buffer(response));
         }
+    } else if (body["type"] == std::string("REQUEST_PI_USERS")) {
+        // The broker missed a delta, it may ask for descriptors in one of the encodings it reads
+        const DescriptorRequest request = descriptor_request(body["payload"]);
+        std::lock_guard<std::mutex> guard(global_pi_users_mutex);
+        const std::string response = messages::updatePIUsers(request);
+        std::cout << "Sending " << response << std::endl;
+        websocket.write(net::buffer(response));
     } else if (body["type"] == std::string("REMOVE_PI_USER")) {
-        // remove user
-        // rewrite users
-        // send ok
-        // send update users
+        std::lock_guard<std::mutex> guard(global_pi_users_mutex);
+        bool removed = false;
+        unsigned int id = 0;
+        try {
+            id = body["payload"].at("userID").get<unsigned int>();
+            removed = remove_user(id);
+        } catch (std::exception& ex) {
+            std::cout << "Could not remove a user" << std::endl;
+            std::cout << ex.what() << std::endl;
+        }
+
+        std::string response = removed
+            ? messages::ok(std::string("REMOVE_PI_USER"))
+            : messages::error(std::string("REMOVE_PI_USER"));
+        std::cout << "Sending " << response << std::endl;
+        websocket.write(net::buffer(response));
+
+        if (removed) {
+            response = messages::userRemoved(id);
+            std::cout << "Sending " << response << std::endl;
+            websocket.write(net::buffer(response));
+        }
     }
 
     return;
@@ -207,7 +314,12 @@ void connect() {
 
             websocket.handshake(global_pi_configuration.brokerHost, "/");
             
-            std::string out = messages::connectPI();
+            connection_descriptors = DescriptorRequest();
+            std::string out;
+            {
+                std::lock_guard<std::mutex> guard(global_pi_users_mutex);
+                out = messages::connectPI();
+            }
             std::cout 
                 << "Sending "
                 << out
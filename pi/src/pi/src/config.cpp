@@ -8,19 +8,44 @@ PIConfiguration defaultPIConfiguration = {
     "0000",
     "facenet128",
     "MYRIAD",
+    2,   // infer requests
+    "network_cache",
+    0,   // CPU streams (plugin default)
+    0,   // CPU threads (plugin default)
+    true,
+    "haar", // face detector (haar, ssd)
     "cascade.xml",
-    "people.json",
+    0.5f,   // detection confidence
+    0,      // minimum face size, 0 is the detector default
+    0,      // detection width, 0 is the full resolution
+    0,      // frames between full-frame detections, 0 disables ROI detection
+    "people.json",    // JSON users, converted into the gallery file once
+    "people.gallery", // binary gallery file
+    "people.journal", // changes made after the gallery file was written
+    100,              // journal records which start the compaction
     "localhost",
     "8080",
     10,  // reconnect time
-    100, // read sensor period  
+    1000, // sensor wait timeout, the sensor interrupt wakes earlier
     29,  // red 
     23,  // green
     3,
+    "wiringpi", // GPIO backend (wiringpi, simulated)
+    "gpio.txt", // simulated GPIO script
+    0,     // camera index
+    "",    // video file or image directory used instead of the camera, e.g. with the simulated GPIO
+    25.,   // replay rate of the video file or the images
+    10000, // recognition window after the last motion
+    1.0f,  // recognition threshold
+    0.02f, // fraction of changed pixels which means motion
     false,
     {
         "facenet.bin",
         "facenet.xml"
+    },
+    {
+        "face-detection.bin",
+        "face-detection.xml"
     }
 };
 
@@ -51,6 +76,36 @@ PIConfiguration initialize_config(const std::string& filename) {
                 piConfiguration.networkVersion = defaultPIConfiguration.networkVersion;
             }
 
+            if (config["faceDetector"].is_string()) {
+                piConfiguration.faceDetector = config["faceDetector"].get<std::string>();
+            } else {
+                piConfiguration.faceDetector = defaultPIConfiguration.faceDetector;
+            }
+
+            if (config["detectionConfidence"].is_number()) {
+                piConfiguration.detectionConfidence = config["detectionConfidence"].get<float>();
+            } else {
+                piConfiguration.detectionConfidence = defaultPIConfiguration.detectionConfidence;
+            }
+
+            if (config["minFaceSize"].is_number()) {
+                piConfiguration.minFaceSize = config["minFaceSize"].get<int>();
+            } else {
+                piConfiguration.minFaceSize = defaultPIConfiguration.minFaceSize;
+            }
+
+            if (config["detectionWidth"].is_number()) {
+                piConfiguration.detectionWidth = config["detectionWidth"].get<int>();
+            } else {
+                piConfiguration.detectionWidth = defaultPIConfiguration.detectionWidth;
+            }
+
+            if (config["detectionRoiFrames"].is_number()) {
+                piConfiguration.detectionRoiFrames = config["detectionRoiFrames"].get<uint>();
+            } else {
+                piConfiguration.detectionRoiFrames = defaultPIConfiguration.detectionRoiFrames;
+            }
+
             if (config["faceHaarCascade"].is_string()) {
                 piConfiguration.faceHaarCascade = config["faceHaarCascade"].get<std::string>();
             } else {
@@ -63,12 +118,60 @@ PIConfiguration initialize_config(const std::string& filename) {
                 piConfiguration.inferenceBackend = defaultPIConfiguration.inferenceBackend;
             }
 
+            if (config["inferRequests"].is_number()) {
+                piConfiguration.inferRequests = config["inferRequests"].get<uint>();
+            } else {
+                piConfiguration.inferRequests = defaultPIConfiguration.inferRequests;
+            }
+
+            if (config["networkCacheDir"].is_string()) {
+                piConfiguration.networkCacheDir = config["networkCacheDir"].get<std::string>();
+            } else {
+                piConfiguration.networkCacheDir = defaultPIConfiguration.networkCacheDir;
+            }
+
+            if (config["cpuStreams"].is_number()) {
+                piConfiguration.cpuStreams = config["cpuStreams"].get<int>();
+            } else {
+                piConfiguration.cpuStreams = defaultPIConfiguration.cpuStreams;
+            }
+
+            if (config["cpuThreads"].is_number()) {
+                piConfiguration.cpuThreads = config["cpuThreads"].get<int>();
+            } else {
+                piConfiguration.cpuThreads = defaultPIConfiguration.cpuThreads;
+            }
+
+            if (config["cpuBindThread"].is_boolean()) {
+                piConfiguration.cpuBindThread = config["cpuBindThread"].get<bool>();
+            } else {
+                piConfiguration.cpuBindThread = defaultPIConfiguration.cpuBindThread;
+            }
+
             if (config["dbFile"].is_string()) {
                 piConfiguration.dbFile = config["dbFile"].get<std::string>();
             } else {
                 piConfiguration.dbFile = defaultPIConfiguration.dbFile;
             }
 
+            if (config["galleryFile"].is_string()) {
+                piConfiguration.galleryFile = config["galleryFile"].get<std::string>();
+            } else {
+                piConfiguration.galleryFile = defaultPIConfiguration.galleryFile;
+            }
+
+            if (config["journalFile"].is_string()) {
+                piConfiguration.journalFile = config["journalFile"].get<std::string>();
+            } else {
+                piConfiguration.journalFile = defaultPIConfiguration.journalFile;
+            }
+
+            if (config["journalCompactRecords"].is_number()) {
+                piConfiguration.journalCompactRecords = config["journalCompactRecords"].get<uint>();
+            } else {
+                piConfiguration.journalCompactRecords = defaultPIConfiguration.journalCompactRecords;
+            }
+
             if (config["brokerHost"].is_string()) {
                 piConfiguration.brokerHost = config["brokerHost"].get<std::string>();
             } else {
@@ -111,6 +214,54 @@ PIConfiguration initialize_config(const std::string& filename) {
                 piConfiguration.hcSR501GPIO = defaultPIConfiguration.hcSR501GPIO;
             }
 
+            if (config["gpioBackend"].is_string()) {
+                piConfiguration.gpioBackend = config["gpioBackend"].get<std::string>();
+            } else {
+                piConfiguration.gpioBackend = defaultPIConfiguration.gpioBackend;
+            }
+
+            if (config["gpioScript"].is_string()) {
+                piConfiguration.gpioScript = config["gpioScript"].get<std::string>();
+            } else {
+                piConfiguration.gpioScript = defaultPIConfiguration.gpioScript;
+            }
+
+            if (config["cameraIndex"].is_number()) {
+                piConfiguration.cameraIndex = config["cameraIndex"].get<int>();
+            } else {
+                piConfiguration.cameraIndex = defaultPIConfiguration.cameraIndex;
+            }
+
+            if (config["cameraInput"].is_string()) {
+                piConfiguration.cameraInput = config["cameraInput"].get<std::string>();
+            } else {
+                piConfiguration.cameraInput = defaultPIConfiguration.cameraInput;
+            }
+
+            if (config["cameraInputFps"].is_number()) {
+                piConfiguration.cameraInputFps = config["cameraInputFps"].get<double>();
+            } else {
+                piConfiguration.cameraInputFps = defaultPIConfiguration.cameraInputFps;
+            }
+
+            if (config["recognitionWindowMs"].is_number()) {
+                piConfiguration.recognitionWindowMs = config["recognitionWindowMs"].get<uint>();
+            } else {
+                piConfiguration.recognitionWindowMs = defaultPIConfiguration.recognitionWindowMs;
+            }
+
+            if (config["recognitionThreshold"].is_number()) {
+                piConfiguration.recognitionThreshold = config["recognitionThreshold"].get<float>();
+            } else {
+                piConfiguration.recognitionThreshold = defaultPIConfiguration.recognitionThreshold;
+            }
+
+            if (config["motionThreshold"].is_number()) {
+                piConfiguration.motionThreshold = config["motionThreshold"].get<float>();
+            } else {
+                piConfiguration.motionThreshold = defaultPIConfiguration.motionThreshold;
+            }
+
             if (config["UI"].is_boolean()) {
                 piConfiguration.UI = config["UI"].get<bool>();
             } else {
@@ -132,6 +283,22 @@ PIConfiguration initialize_config(const std::string& filename) {
                 piConfiguration.network.xml = defaultPIConfiguration.network.xml;
                 piConfiguration.network.bin = defaultPIConfiguration.network.bin;
             }
+
+            if (config["detectorNetwork"].is_object()) {
+                if (config["detectorNetwork"]["xml"].is_string()) {
+                    piConfiguration.detectorNetwork.xml = config["detectorNetwork"]["xml"].get<std::string>();
+                } else {
+                    piConfiguration.detectorNetwork.xml = defaultPIConfiguration.detectorNetwork.xml;
+                }
+                if (config["detectorNetwork"]["bin"].is_string()) {
+                    piConfiguration.detectorNetwork.bin = config["detectorNetwork"]["bin"].get<std::string>();
+                } else {
+                    piConfiguration.detectorNetwork.bin = defaultPIConfiguration.detectorNetwork.bin;
+                }
+            } else {
+                piConfiguration.detectorNetwork.xml = defaultPIConfiguration.detectorNetwork.xml;
+                piConfiguration.detectorNetwork.bin = defaultPIConfiguration.detectorNetwork.bin;
+            }
         } catch (std::exception& ex) {
             std::cout << ex.what() << std::endl;
         }
@@ -152,17 +319,41 @@ void print_config(const PIConfiguration& configuration) {
     std::cout << "\tDevice PIN: " << configuration.devicePIN << std::endl;
     std::cout << "\tNetwork version: " << configuration.networkVersion << std::endl;
     std::cout << "\tNeural backend: " << configuration.inferenceBackend << std::endl;
+    std::cout << "\tInfer requests: " << configuration.inferRequests << std::endl;
+    std::cout << "\tCompiled network cache: " << configuration.networkCacheDir << std::endl;
+    std::cout << "\tCPU streams: " << configuration.cpuStreams << std::endl;
+    std::cout << "\tCPU threads: " << configuration.cpuThreads << std::endl;
+    std::cout << "\tCPU bind thread: " << (configuration.cpuBindThread ? "yes" : "no") << std::endl;
+    std::cout << "\tFace detector: " << configuration.faceDetector << std::endl;
     std::cout << "\tHaar cascade: " << configuration.faceHaarCascade << std::endl;
+    std::cout << "\tDetection confidence: " << configuration.detectionConfidence << std::endl;
+    std::cout << "\tMinimum face size: " << configuration.minFaceSize << std::endl;
+    std::cout << "\tDetection width: " << configuration.detectionWidth << std::endl;
+    std::cout << "\tFrames between full-frame detections: " << configuration.detectionRoiFrames << std::endl;
     std::cout << "\tDatabase file: " << configuration.dbFile << std::endl;
+    std::cout << "\tGallery file: " << configuration.galleryFile << std::endl;
+    std::cout << "\tJournal file: " << configuration.journalFile << std::endl;
+    std::cout << "\tJournal records before compaction: " << configuration.journalCompactRecords << std::endl;
     std::cout << "\tBroker host: " << configuration.brokerHost << std::endl;
     std::cout << "\tBroker port: " << configuration.brokerPort << std::endl;
     std::cout << "\tReconnect to broker time (sec): " << configuration.reconnectTimeSec << std::endl;
-    std::cout << "\tRead sensors period (ms): " << configuration.readSensorTimeMs << std::endl;
+    std::cout << "\tSensor wait timeout (ms): " << configuration.readSensorTimeMs << std::endl;
     std::cout << "\tRed diode GPIO number: " << configuration.redDiodeGPIO << std::endl;
     std::cout << "\tGreen diode GPIO number: " << configuration.greenDiodeGPIO << std::endl;
     std::cout << "\tSensor HC SR-501 GPIO number: " << configuration.hcSR501GPIO << std::endl;
+    std::cout << "\tGPIO backend: " << configuration.gpioBackend << std::endl;
+    std::cout << "\tGPIO script: " << configuration.gpioScript << std::endl;
+    std::cout << "\tCamera index: " << configuration.cameraIndex << std::endl;
+    std::cout << "\tCamera input: " << configuration.cameraInput << std::endl;
+    std::cout << "\tCamera input FPS: " << configuration.cameraInputFps << std::endl;
+    std::cout << "\tRecognition window (ms): " << configuration.recognitionWindowMs << std::endl;
+    std::cout << "\tRecognition threshold: " << configuration.recognitionThreshold << std::endl;
+    std::cout << "\tMotion threshold: " << configuration.motionThreshold << std::endl;
     std::cout << "\tWith UI: " << (configuration.UI ? "yes" : "no") << std::endl;
     std::cout << "\tModel: " << std::endl;
     std::cout << "\t\tXML: " << configuration.network.xml << std::endl;
-    std::cout << "\t\tBIN: " << configuration.network.bin << "\n\n\n" << std::endl;
+    std::cout << "\t\tBIN: " << configuration.network.bin << std::endl;
+    std::cout << "\tFace detection model: " << std::endl;
+    std::cout << "\t\tXML: " << configuration.detectorNetwork.xml << std::endl;
+    std::cout << "\t\tBIN: " << configuration.detectorNetwork.bin << "\n\n\n" << std::endl;
 }
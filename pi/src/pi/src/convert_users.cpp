@@ -0,0 +1,22 @@
+#include <string>
+#include <iostream>
+
+#include <macros_defs.h>
+#include <config.hpp>
+#include <users.hpp>
+
+// One-shot conversion of the JSON users into the binary gallery
+// Usage: PIUsersConverter [config.json]
+// PIApp converts the files on start too, if the gallery file doesn't exist
+int main(int argc, char* argv[]) {
+    const PIConfiguration configuration = initialize_config(std::string(argc > 1 ? argv[1] : "config.json"));
+    // Without users the gallery gets the descriptor size of the only supported network
+    const bool converted = convert_users(
+        configuration.dbFile,
+        configuration.galleryFile,
+        configuration.networkVersion,
+        SIZE_OF_IEFACENET_V1
+    );
+
+    return converted ? EXIT_SUCCESS : EXIT_FAILURE;
+}
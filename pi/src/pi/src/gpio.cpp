@@ -0,0 +1,23 @@
+#include <stdexcept>
+
+#include <gpio.hpp>
+#include <simulated_gpio.hpp>
+#ifdef PI_WITH_WIRINGPI
+#include <wiringpi_gpio.hpp>
+#endif
+
+std::shared_ptr<GPIO> build_gpio(const std::string& backend, const std::string& script) {
+    if (backend == std::string("simulated")) {
+        return std::make_shared<SimulatedGPIO>(script);
+    }
+
+    if (backend == std::string("wiringpi")) {
+#ifdef PI_WITH_WIRINGPI
+        return std::make_shared<WiringPiGPIO>();
+#else
+        throw std::runtime_error("PIApp is built without wiringPi, only the simulated GPIO is available");
+#endif
+    }
+
+    throw std::invalid_argument("Unknown GPIO backend " + backend);
+}
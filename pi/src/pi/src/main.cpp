@@ -2,63 +2,101 @@
 #include <thread>
 #include <iostream>
 #include <functional>
-#include <wiringPi.h>
 
 #include <broker.hpp>
 #include <globals.hpp>
-
-
-// create classifier
-// create detector
-// add mutex detector
-// add mutex classifier
+#include <recognition.hpp>
 
 PIConfiguration global_pi_configuration;
 std::vector<User> global_pi_users;
+uint64_t global_pi_users_revision = 0;
+uint64_t global_pi_users_hash = 0;
 std::shared_ptr<Classifier> global_pi_classifier;
-cv::CascadeClassifier global_pi_face_detector;
+std::shared_ptr<FaceDetector> global_pi_face_detector;
 std::mutex global_pi_users_mutex;
-std::mutex global_pi_classifier_mutex;
-std::mutex global_pi_face_detector_mutex;
+std::shared_ptr<GPIO> global_pi_gpio;
 
 int main() {
     global_pi_configuration = initialize_config(std::string("config.json"));
     print_config(global_pi_configuration);
 
-    global_pi_users = read_users(global_pi_configuration.dbFile, global_pi_configuration.networkVersion);
-    global_pi_face_detector.load(global_pi_configuration.faceHaarCascade);
-    // global_pi_classifier = build_classifier(
-    //     ClassifierType::IE_Facenet_V1,
-    //     global_pi_configuration.network.xml,
-    //     global_pi_configuration.network.bin,
-    //     global_pi_configuration.inferenceBackend
-    // );
+    const std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
+    ClassifierOptions classifier_options;
+    classifier_options.infer_requests = global_pi_configuration.inferRequests;
+    classifier_options.cache_dir = global_pi_configuration.networkCacheDir;
+    classifier_options.cpu_streams = global_pi_configuration.cpuStreams;
+    classifier_options.cpu_threads = global_pi_configuration.cpuThreads;
+    classifier_options.cpu_bind_thread = global_pi_configuration.cpuBindThread;
+    global_pi_classifier = build_classifier(
+        ClassifierType::IE_Facenet_V1,
+        global_pi_configuration.network.xml,
+        global_pi_configuration.network.bin,
+        global_pi_configuration.inferenceBackend,
+        classifier_options
+    );
+    std::cout
+        << "Classifier has been loaded in "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - load_start).count()
+        << " ms" << std::endl;
 
+    // The network detector shares the inference engine and the device with the classifier
+    DetectorOptions detector_options;
+    detector_options.confidence = global_pi_configuration.detectionConfidence;
+    detector_options.min_face_size = cv::Size(global_pi_configuration.minFaceSize, global_pi_configuration.minFaceSize);
+    detector_options.detection_width = global_pi_configuration.detectionWidth;
+    detector_options.cache_dir = global_pi_configuration.networkCacheDir;
+    if (global_pi_configuration.faceDetector == std::string("ssd")) {
+        global_pi_face_detector = build_detector(
+            DetectorType::IE_SSD,
+            global_pi_configuration.detectorNetwork.xml,
+            global_pi_configuration.detectorNetwork.bin,
+            global_pi_configuration.inferenceBackend,
+            detector_options
+        );
+    } else {
+        global_pi_face_detector = build_detector(
+            DetectorType::Haar_Cascade,
+            global_pi_configuration.faceHaarCascade,
+            std::string(),
+            std::string(),
+            detector_options
+        );
+    }
 
-    std::thread socket_thread(connect);
+    {
+        std::lock_guard<std::mutex> guard(global_pi_users_mutex);
+        load_gallery(global_pi_users);
+    }
+
+    global_pi_gpio = build_gpio(global_pi_configuration.gpioBackend, global_pi_configuration.gpioScript);
+    global_pi_gpio->output(global_pi_configuration.redDiodeGPIO);
+    global_pi_gpio->output(global_pi_configuration.greenDiodeGPIO);
+    global_pi_gpio->input(global_pi_configuration.hcSR501GPIO);
 
-    wiringPiSetup();    
-    pinMode(global_pi_configuration.redDiodeGPIO, OUTPUT);
-    pinMode(global_pi_configuration.greenDiodeGPIO, OUTPUT);
-    pinMode(global_pi_configuration.hcSR501GPIO, INPUT);
+    std::thread socket_thread(connect);
 
-    bool movement = false;
+    // The camera and the detector stay idle until the sensor sees motion
+    global_pi_gpio->write(global_pi_configuration.redDiodeGPIO, false);
+    global_pi_gpio->write(global_pi_configuration.greenDiodeGPIO, false);
     while(true) {
-        if (digitalRead(global_pi_configuration.hcSR501GPIO)) {
-            digitalWrite(global_pi_configuration.redDiodeGPIO, 1); 
-            digitalWrite(global_pi_configuration.greenDiodeGPIO, 0); 
-        } else {
-            digitalWrite(global_pi_configuration.redDiodeGPIO, 1); 
-            digitalWrite(global_pi_configuration.greenDiodeGPIO, 1); 
+        // A finished script may leave the sensor pin high, so the wait alone never ends the loop
+        if (global_pi_gpio->closed()) {
+            std::cout << "GPIO inputs are closed, exiting" << std::endl;
+            break;
         }
 
-        std::this_thread::sleep_for(
-            std::chrono::milliseconds(
-                global_pi_configuration.readSensorTimeMs
-            )
-        );
+        // The sensor edge wakes the thread, the timeout only bounds a missed one
+        if (global_pi_gpio->wait_high(
+            global_pi_configuration.hcSR501GPIO,
+            std::chrono::milliseconds(global_pi_configuration.readSensorTimeMs)
+        )) {
+            recognize_motion();
+        }
     }
 
-    socket_thread.join();
+    // The broker thread reconnects forever
+    socket_thread.detach();
+    close_gallery();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,328 @@
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <shared_mutex>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <gallery_file.hpp>
+#include <gallery_journal.hpp>
+#include <frame_source.hpp>
+#include <recognition_pipeline.hpp>
+#include <recognition.hpp>
+#include <globals.hpp>
+
+// Known faces, searches run in parallel with enrollment
+// Rows are searched in the mapped gallery file until the first enrollment copies them into memory
+static std::unique_ptr<MappedGallery> mapped_gallery;
+static std::unique_ptr<FaceGallery> memory_gallery;
+static FaceGallery* gallery = nullptr;
+static std::map<unsigned int, std::string> gallery_names;
+static std::shared_mutex gallery_mutex;
+
+// Changes made after the gallery file was written, they are compacted into it in the background
+static std::unique_ptr<GalleryJournal> journal;
+static std::thread compaction;
+static std::atomic<bool> compacting(false);
+
+// Size of frames compared by the motion gate
+static const cv::Size MOTION_FRAME_SIZE = cv::Size(80, 60);
+// Minimum brightness change of a moving pixel
+static const double MOTION_PIXEL_THRESHOLD = 25;
+
+// Journal records which are being compacted into the gallery file
+static std::string compacted_journal() {
+    return global_pi_configuration.journalFile + ".compacting";
+}
+
+static void apply_record(const JournalRecord& record, FaceGallery& target, std::vector<User>& users) {
+    const unsigned int id = record.id;
+    std::vector<User>::iterator user = std::find_if(users.begin(), users.end(), [id](const User& candidate) {
+        return candidate.id() == id;
+    });
+
+    if (record.type == JournalRecordType::Remove) {
+        target.remove(id);
+        if (user != users.end()) {
+            users.erase(user);
+        }
+    } else if (record.descriptor.size() == target.dimension()) {
+        User added;
+        added.parseMetadata(id, record.metadata);
+        target.add(id, record.descriptor);
+        if (user != users.end()) {
+            *user = added;
+        } else {
+            users.push_back(added);
+        }
+    }
+}
+
+// Writes the gallery and the users into the gallery file and removes the compacted journal records
+// The file and the records are never lost together: the records are removed after the file is renamed,
+// and replaying them over the new file changes nothing
+static void compact_gallery() {
+    // The flag is cleared on every exit, otherwise no compaction would ever start again
+    struct CompactingGuard {
+        ~CompactingGuard() {
+            compacting = false;
+        }
+    } guard;
+
+    const PIConfiguration& configuration = global_pi_configuration;
+    const std::string rotated = compacted_journal();
+    // The thread is detached from any caller, an exception must not leave it
+    try {
+        std::unique_ptr<FaceGallery> snapshot(new FaceGallery(global_pi_classifier->descriptor_size()));
+        std::vector<User> users;
+        {
+            // The copies are quick, enrollment waits only for them and not for the file
+            std::lock_guard<std::mutex> users_guard(global_pi_users_mutex);
+            if (!std::ifstream(rotated).good()) {
+                journal->rotate(rotated);
+            }
+            users = global_pi_users;
+            std::shared_lock<std::shared_mutex> lock(gallery_mutex);
+            snapshot->assign(*gallery);
+        }
+
+        write_gallery(users, *snapshot, configuration.galleryFile, configuration.networkVersion);
+        std::remove(rotated.c_str());
+        std::cout << "Gallery has been compacted, " << users.size() << " users" << std::endl;
+    } catch (std::exception& ex) {
+        // The records stay in the journal or the rotated one, the next compaction retries
+        std::cout << "Could not compact the gallery" << std::endl;
+        std::cout << ex.what() << std::endl;
+    }
+}
+
+// The caller holds global_pi_users_mutex
+static void compact_gallery_if_needed(bool force) {
+    const bool needed = force || journal->records() >= global_pi_configuration.journalCompactRecords;
+    if (!needed || compacting) {
+        return;
+    }
+
+    // The previous compaction has finished, it cleared the flag as its last action
+    if (compaction.joinable()) {
+        compaction.join();
+    }
+
+    compacting = true;
+    compaction = std::thread(compact_gallery);
+}
+
+void load_gallery(std::vector<User>& users) {
+    const PIConfiguration& configuration = global_pi_configuration;
+    const size_t dimension = global_pi_classifier->descriptor_size();
+    // JSON users are converted once, after that the gallery file is the only storage
+    if (!std::ifstream(configuration.galleryFile).good() && std::ifstream(configuration.dbFile).good()) {
+        convert_users(configuration.dbFile, configuration.galleryFile, configuration.networkVersion, dimension);
+    }
+
+    std::unique_ptr<MappedGallery> mapped = read_gallery(
+        configuration.galleryFile,
+        configuration.networkVersion,
+        users
+    );
+    if (mapped && mapped->dimension() != dimension) {
+        std::cout << "Gallery descriptors don't match the network, the gallery is ignored" << std::endl;
+        mapped.reset();
+        users.clear();
+    }
+
+    // Without a file users start from scratch, the first compaction writes it
+    std::unique_ptr<FaceGallery> memory;
+    if (!mapped) {
+        memory.reset(new FaceGallery(dimension));
+    }
+
+    // Records of an interrupted compaction go first, they are older than the journal ones
+    FaceGallery& loaded = mapped ? mapped->gallery() : *memory;
+    const std::function<void(const JournalRecord&)> apply = [&loaded, &users](const JournalRecord& record) {
+        apply_record(record, loaded, users);
+    };
+    const bool interrupted = std::ifstream(compacted_journal()).good();
+    const size_t replayed = replay_journal(compacted_journal(), apply) + replay_journal(configuration.journalFile, apply);
+    std::cout << "Replayed " << replayed << " journal records" << std::endl;
+
+    // Ids of new users continue after the loaded ones
+    std::map<unsigned int, std::string> names;
+    unsigned int max_id = 0;
+    for (const User& user: users) {
+        names[user.id()] = user.name();
+        max_id = std::max(max_id, user.id());
+    }
+    id_generator(max_id);
+    global_pi_users_hash = users_hash(users);
+
+    {
+        std::unique_lock<std::shared_mutex> lock(gallery_mutex);
+        mapped_gallery.swap(mapped);
+        memory_gallery.swap(memory);
+        gallery = mapped_gallery ? &mapped_gallery->gallery() : memory_gallery.get();
+        gallery_names.swap(names);
+    }
+
+    journal.reset(new GalleryJournal(configuration.journalFile));
+    compact_gallery_if_needed(interrupted);
+}
+
+void enroll_user(const User& user) {
+    // An existing user would lose the descriptor and be listed twice
+    const bool exists = std::any_of(global_pi_users.begin(), global_pi_users.end(), [&user](const User& candidate) {
+        return candidate.id() == user.id();
+    });
+    if (exists) {
+        throw std::runtime_error("User " + std::to_string(user.id()) + " already exists");
+    }
+
+    // The record is on the storage before the user is recognized
+    journal->add(user.id(), user.descriptor(), user.toMetadata());
+    global_pi_users.push_back(user);
+    global_pi_users_revision++;
+    global_pi_users_hash += user.hash();
+    {
+        std::unique_lock<std::shared_mutex> lock(gallery_mutex);
+        gallery->add(user.id(), user.descriptor());
+        gallery_names[user.id()] = user.name();
+    }
+
+    compact_gallery_if_needed(false);
+}
+
+bool remove_user(unsigned int id) {
+    std::vector<User>::iterator user = std::find_if(global_pi_users.begin(), global_pi_users.end(),
+        [id](const User& candidate) {
+            return candidate.id() == id;
+        });
+    if (user == global_pi_users.end()) {
+        return false;
+    }
+
+    journal->remove(id);
+    global_pi_users_hash -= user->hash();
+    global_pi_users.erase(user);
+    global_pi_users_revision++;
+    {
+        std::unique_lock<std::shared_mutex> lock(gallery_mutex);
+        gallery->remove(id);
+        gallery_names.erase(id);
+    }
+
+    compact_gallery_if_needed(false);
+    return true;
+}
+
+bool stored_descriptor(unsigned int id, std::vector<float>& descriptor) {
+    std::shared_lock<std::shared_mutex> lock(gallery_mutex);
+    return gallery && gallery->descriptor(id, descriptor);
+}
+
+void close_gallery() {
+    if (compaction.joinable()) {
+        compaction.join();
+    }
+}
+
+static bool match_face(const float* descriptor, float threshold, GalleryMatch& match) {
+    std::shared_lock<std::shared_mutex> lock(gallery_mutex);
+    return gallery && gallery->search(descriptor, 1, threshold, &match) > 0;
+}
+
+static void set_diodes(bool red, bool green) {
+    global_pi_gpio->write(global_pi_configuration.redDiodeGPIO, red);
+    global_pi_gpio->write(global_pi_configuration.greenDiodeGPIO, green);
+}
+
+// Green diode means a known person, red one means only strangers are in front of the camera
+static void show_result(const RecognitionResult& result) {
+    if (result.faces.empty()) {
+        return;
+    }
+
+    bool identified = false;
+    for (const RecognizedFace& face: result.faces) {
+        if (face.identified) {
+            identified = true;
+            std::shared_lock<std::shared_mutex> lock(gallery_mutex);
+            std::map<unsigned int, std::string>::const_iterator name = gallery_names.find(face.id);
+            if (name != gallery_names.end()) {
+                std::cout << "Recognized " << name->second << " (" << face.distance << ")" << std::endl;
+            }
+        }
+    }
+
+    set_diodes(!identified, identified);
+}
+
+void recognize_motion() {
+    const PIConfiguration& configuration = global_pi_configuration;
+    // A clip or an image directory replaces the camera, so the simulated GPIO runs without hardware
+    const std::string input = configuration.cameraInput.empty()
+        ? std::to_string(configuration.cameraIndex)
+        : configuration.cameraInput;
+    std::unique_ptr<FrameSource> capture;
+    try {
+        capture.reset(new FrameSource(input, configuration.cameraInput.empty() ? 0. : configuration.cameraInputFps));
+    } catch (std::exception& ex) {
+        std::cout << ex.what() << std::endl;
+        return;
+    }
+
+    {
+        PipelineOptions options;
+        options.threshold = configuration.recognitionThreshold;
+        options.roi_refresh_frames = configuration.detectionRoiFrames;
+        RecognitionPipeline pipeline(global_pi_classifier, global_pi_face_detector, match_face, show_result, options);
+
+        const std::chrono::milliseconds window(configuration.recognitionWindowMs);
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + window;
+        cv::Mat frame, small, previous, difference;
+        int64_t timestamp = 0;
+        size_t passed = 0, skipped = 0;
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (!capture->read(frame)) {
+                std::cout << "Could not read a frame from " << input << std::endl;
+                break;
+            }
+
+            // The gate compares small gray copies, it is much cheaper than detection
+            cv::resize(frame, small, MOTION_FRAME_SIZE, 0, 0, cv::INTER_AREA);
+            cv::cvtColor(small, small, cv::COLOR_BGR2GRAY);
+            bool moving = previous.empty();
+            if (!moving) {
+                cv::absdiff(small, previous, difference);
+                cv::threshold(difference, difference, MOTION_PIXEL_THRESHOLD, 255, cv::THRESH_BINARY);
+                moving = cv::countNonZero(difference) >= configuration.motionThreshold * MOTION_FRAME_SIZE.area();
+            }
+
+            // Either trigger keeps the window open
+            if (moving || global_pi_gpio->read(configuration.hcSR501GPIO)) {
+                deadline = std::chrono::steady_clock::now() + window;
+            }
+
+            if (moving) {
+                std::swap(small, previous);
+                pipeline.push(frame, FrameFormat::BGR_Frame, timestamp++);
+                passed++;
+            } else {
+                skipped++;
+            }
+        }
+
+        std::cout
+            << "Recognition window is closed, "
+            << passed << " frames passed to recognition, "
+            << skipped << " still frames skipped, "
+            << pipeline.dropped() << " dropped" << std::endl;
+    }
+
+    // The pipeline is stopped, so no late result turns a diode on again
+    set_diodes(false, false);
+}
@@ -0,0 +1,104 @@
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <simulated_gpio.hpp>
+
+SimulatedGPIO::SimulatedGPIO(const std::string& script)
+    : _closed(false)
+    , _stopping(false) {
+    std::ifstream script_file(script, std::ios::in);
+    if (!script_file.is_open()) {
+        throw std::runtime_error("Could not open GPIO script " + script);
+    }
+
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(script_file, line)) {
+        line_number++;
+        const size_t comment = line.find('#');
+        std::istringstream fields(line.substr(0, comment));
+        long delay = 0;
+        unsigned int pin = 0;
+        int value = 0;
+        if (!(fields >> delay)) {
+            // Empty line or a comment
+            continue;
+        }
+
+        if (!(fields >> pin >> value) || delay < 0 || (value != 0 && value != 1)) {
+            throw std::runtime_error(
+                "Wrong GPIO script line " + std::to_string(line_number) + ", expected \"<delay ms> <pin> <0|1>\""
+            );
+        }
+
+        this->_events.push_back({std::chrono::milliseconds(delay), pin, value == 1});
+    }
+
+    std::cout << "GPIO script " << script << " has " << this->_events.size() << " events" << std::endl;
+    this->_player = std::thread(&SimulatedGPIO::play, this);
+}
+
+void SimulatedGPIO::play() {
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    for (const Event& event: this->_events) {
+        // Stopping interrupts the delay
+        if (this->_changed.wait_for(lock, event.delay, [this]() { return this->_stopping; })) {
+            break;
+        }
+
+        this->_pins[event.pin] = event.value;
+        std::cout << "GPIO " << event.pin << " <- " << event.value << std::endl;
+        this->_changed.notify_all();
+    }
+
+    this->_closed = true;
+    this->_changed.notify_all();
+}
+
+void SimulatedGPIO::input(unsigned int pin) {
+    std::lock_guard<std::mutex> guard(this->_mutex);
+    this->_pins.emplace(pin, false);
+}
+
+void SimulatedGPIO::output(unsigned int pin) {
+    std::lock_guard<std::mutex> guard(this->_mutex);
+    this->_pins.emplace(pin, false);
+}
+
+bool SimulatedGPIO::read(unsigned int pin) {
+    std::lock_guard<std::mutex> guard(this->_mutex);
+    return this->_pins[pin];
+}
+
+void SimulatedGPIO::write(unsigned int pin, bool value) {
+    std::lock_guard<std::mutex> guard(this->_mutex);
+    bool& current = this->_pins[pin];
+    if (current != value) {
+        current = value;
+        std::cout << "GPIO " << pin << " -> " << value << std::endl;
+    }
+}
+
+bool SimulatedGPIO::wait_high(unsigned int pin, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    // A closed script wakes the waiter, nothing can raise the pin after that
+    this->_changed.wait_for(lock, timeout, [this, pin]() { return this->_pins[pin] || this->_closed; });
+    return this->_pins[pin];
+}
+
+bool SimulatedGPIO::closed() const {
+    std::lock_guard<std::mutex> guard(this->_mutex);
+    return this->_closed;
+}
+
+SimulatedGPIO::~SimulatedGPIO() {
+    {
+        std::lock_guard<std::mutex> guard(this->_mutex);
+        this->_stopping = true;
+    }
+
+    this->_changed.notify_all();
+    this->_player.join();
+}
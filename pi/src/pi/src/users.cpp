@@ -1,11 +1,148 @@
+#include <map>
+#include <string>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <algorithm>
 #include <users.hpp>
+#include <base64.hpp>
 
-unsigned int id_generator(unsigned int initial_low_bound = 0) {
+// Separates metadata fields, it can't appear in JSON strings received from the broker
+static const char METADATA_SEPARATOR = '\0';
+
+DescriptorEncoding descriptor_encoding(const json& version) {
+    if (version.is_null()) {
+        return DescriptorEncoding::JSON_Array;
+    }
+
+    const int number = version.get<int>();
+    if (number < int(DescriptorEncoding::JSON_Array) || number > int(DescriptorEncoding::Base64_Float16)) {
+        throw std::runtime_error("Unknown descriptor version " + std::to_string(number));
+    }
+    return DescriptorEncoding(number);
+}
+
+// Rounds to the nearest half float, ties to even
+static uint16_t to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const int32_t exponent = int32_t((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (((bits >> 23) & 0xff) == 0xff) {
+        return uint16_t(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    }
+
+    if (exponent >= 31) {
+        return uint16_t(sign | 0x7c00);
+    }
+
+    // Subnormal half floats
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return uint16_t(sign);
+        }
+
+        mantissa |= 0x800000;
+        const uint32_t shift = uint32_t(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) {
+            half++;
+        }
+        return uint16_t(sign | half);
+    }
+
+    // A carry from the mantissa correctly moves the exponent, up to infinity
+    uint32_t half = (uint32_t(exponent) << 10) | (mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return uint16_t(sign | half);
+}
+
+static float from_half(uint16_t value) {
+    const uint32_t sign = uint32_t(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits = sign;
+    if (exponent == 0x1f) {
+        bits |= 0x7f800000 | (mantissa << 13);
+    } else if (exponent) {
+        bits |= ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else if (mantissa) {
+        // Subnormal half floats are normal floats
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits |= (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Bytes are written in little-endian order whatever the host is
+static json encode_descriptor(const std::vector<float>& descriptor, DescriptorEncoding encoding) {
+    if (encoding == DescriptorEncoding::JSON_Array) {
+        return json(descriptor);
+    }
+
+    const size_t width = encoding == DescriptorEncoding::Base64_Float16 ? 2 : 4;
+    std::vector<unsigned char> bytes(descriptor.size() * width);
+    for (size_t i = 0; i < descriptor.size(); i++) {
+        uint32_t bits = 0;
+        if (width == 2) {
+            bits = to_half(descriptor[i]);
+        } else {
+            memcpy(&bits, &descriptor[i], sizeof(bits));
+        }
+
+        for (size_t byte = 0; byte < width; byte++) {
+            bytes[i * width + byte] = (bits >> (8 * byte)) & 0xff;
+        }
+    }
+
+    return json(base64_encode(bytes.data(), (unsigned int)(bytes.size())));
+}
+
+static std::vector<float> decode_descriptor(const json& source, DescriptorEncoding encoding) {
+    if (encoding == DescriptorEncoding::JSON_Array) {
+        return source.get<std::vector<float>>();
+    }
+
+    const size_t width = encoding == DescriptorEncoding::Base64_Float16 ? 2 : 4;
+    const std::string bytes = base64_decode(source.get<std::string>());
+    if (bytes.size() % width) {
+        throw std::runtime_error(std::string("Encoded descriptor is damaged"));
+    }
+
+    std::vector<float> descriptor(bytes.size() / width);
+    for (size_t i = 0; i < descriptor.size(); i++) {
+        uint32_t bits = 0;
+        for (size_t byte = 0; byte < width; byte++) {
+            bits |= uint32_t(uint8_t(bytes[i * width + byte])) << (8 * byte);
+        }
+
+        if (width == 2) {
+            descriptor[i] = from_half(uint16_t(bits));
+        } else {
+            memcpy(&descriptor[i], &bits, sizeof(bits));
+        }
+    }
+
+    return descriptor;
+}
+
+unsigned int id_generator(unsigned int initial_low_bound) {
     static unsigned int id = 0;
     if (initial_low_bound) {
-        id = initial_low_bound;
+        id = std::max(id, initial_low_bound);
         return id;
     }
 
@@ -19,7 +156,19 @@ void User::embed(const std::vector<float> descriptor) {
     std::copy(descriptor.begin(), descriptor.end(), this->_descriptor.begin());
 }
 
-json User::toJSON() const {
+unsigned int User::id() const {
+    return this->_id;
+}
+
+std::string User::name() const {
+    return this->_firstname + " " + this->_secondname;
+}
+
+const std::vector<float>& User::descriptor() const {
+    return this->_descriptor;
+}
+
+json User::toJSON(bool withDescriptor, DescriptorEncoding encoding) const {
     json result;
     result["firstname"] = this->_firstname;
     result["secondname"] = this->_secondname;
@@ -28,19 +177,26 @@ json User::toJSON() const {
     }
     result["passport"] = this->_passport;
     result["id"] = this->_id;
-    if (this->_descriptor.size()) {
-        result["descriptor"] = json(this->_descriptor);
+    if (withDescriptor && this->_descriptor.size()) {
+        result["descriptor"] = encode_descriptor(this->_descriptor, encoding);
     }
     return result;
 }
 
-void User::parseJSON(const json& source) {
-    const json& firstname = source["firstname"];
-    const json& secondname = source["secondname"];
-    const json& patronymic = source["patronymic"];
-    const json& passport = source["passport"];
-    const json& id = source["id"];
-    const json& descriptor = source["descriptor"];
+// Optional fields are missing in JSON written by toJSON, operator[] of a const object must not be used for them
+static const json& optional_field(const json& source, const char* key) {
+    static const json missing;
+    const json::const_iterator field = source.find(key);
+    return field != source.end() ? *field : missing;
+}
+
+void User::parseJSON(const json& source, DescriptorEncoding encoding) {
+    const json& firstname = source.at("firstname");
+    const json& secondname = source.at("secondname");
+    const json& patronymic = optional_field(source, "patronymic");
+    const json& passport = source.at("passport");
+    const json& id = optional_field(source, "id");
+    const json& descriptor = optional_field(source, "descriptor");
 
     this->_firstname = firstname.get<std::string>();
     this->_secondname = secondname.get<std::string>();
@@ -56,32 +212,88 @@ void User::parseJSON(const json& source) {
         this->_patronymic = patronymic.get<std::string>();
     }   
 
-    if (descriptor.is_array()) {
-        this->_descriptor = descriptor.get<std::vector<float>>();
+    if (descriptor.is_array() || descriptor.is_string()) {
+        this->_descriptor = decode_descriptor(descriptor, encoding);
     }
 }
 
+std::string User::toMetadata() const {
+    std::string result;
+    for (const std::string* field: {&this->_firstname, &this->_secondname, &this->_patronymic, &this->_passport}) {
+        result += *field;
+        result += METADATA_SEPARATOR;
+    }
+    return result;
+}
+
+void User::parseMetadata(unsigned int id, const std::string& metadata) {
+    std::vector<std::string> fields;
+    size_t begin = 0;
+    for (size_t end = metadata.find(METADATA_SEPARATOR); end != std::string::npos;
+        end = metadata.find(METADATA_SEPARATOR, begin)) {
+        fields.push_back(metadata.substr(begin, end - begin));
+        begin = end + 1;
+    }
+
+    if (fields.size() != 4) {
+        throw std::runtime_error(std::string("User metadata is damaged"));
+    }
+
+    this->_id = id;
+    this->_firstname = fields[0];
+    this->_secondname = fields[1];
+    this->_patronymic = fields[2];
+    this->_passport = fields[3];
+    this->_descriptor.clear();
+}
+
+uint64_t User::hash() const {
+    // FNV-1a
+    uint64_t result = 14695981039346656037ull;
+    const std::string data = std::to_string(this->_id) + METADATA_SEPARATOR + this->toMetadata();
+    for (const char byte: data) {
+        result = (result ^ uint8_t(byte)) * 1099511628211ull;
+    }
+    return result;
+}
+
 User::~User() {}
 
+uint64_t users_hash(const std::vector<User>& users) {
+    uint64_t result = 0;
+    for (const User& user: users) {
+        result += user.hash();
+    }
+    return result;
+}
+
+// Throws std::exception if the text is not a users file of the network
+static std::vector<User> parse_users(const std::string& text, const std::string& networkVersion) {
+    json parsed_users = json::parse(text);
+    if (parsed_users.at("networkVersion").get<std::string>() != networkVersion) {
+        throw std::runtime_error(
+            std::string("Network version in the file distinguish from the current")
+        );
+    }
+
+    const DescriptorEncoding encoding = descriptor_encoding(parsed_users["descriptorVersion"]);
+    std::vector<User> users;
+    for (json& user: parsed_users.at("users")) {
+        User user_instance;
+        user_instance.parseJSON(user, encoding);
+        users.push_back(user_instance);
+    }
+
+    return users;
+}
+
 std::vector<User> read_users(const std::string& filename, const std::string& networkVersion) {
     std::ifstream users_file(filename, std::ios::in);
     if (users_file.is_open()) {
         try {
             std::stringstream buffer;
             buffer << users_file.rdbuf();
-            json parsed_users = json::parse(buffer.str());
-            if (parsed_users.at("networkVersion").get<std::string>() != networkVersion) {
-                throw std::runtime_error(
-                    std::string("Network version in the file distinguish from the current")
-                );
-            }
-
-            std::vector<User> users;
-            for (json& user: parsed_users.at("users")) {
-                User user_instance;
-                user_instance.parseJSON(user);
-                users.push_back(user_instance);
-            }
+            std::vector<User> users = parse_users(buffer.str(), networkVersion);
 
             std::cout << "Users have been read from the file " << filename << std::endl;
             users_file.close();
@@ -101,7 +313,8 @@ std::vector<User> read_users(const std::string& filename, const std::string& net
 void update_users(
     const std::vector<User>& users,
     const std::string& filename,
-    const std::string& networkVersion
+    const std::string& networkVersion,
+    DescriptorEncoding encoding
 ) {
     std::ofstream users_file(filename, std::ios::out);
 
@@ -112,10 +325,11 @@ void update_users(
 
     try {
         json body = json::object();
-        body["version"] = networkVersion;
+        body["networkVersion"] = networkVersion;
+        body["descriptorVersion"] = int(encoding);
         body["users"] = json::array();
         for (const User& user: users) {
-            body["users"].push_back(user.toJSON());
+            body["users"].push_back(user.toJSON(true, encoding));
         }
         users_file << body.dump();
     } catch (std::exception& ex) {
@@ -125,3 +339,109 @@ void update_users(
     users_file.close();
     return;
 }
+
+std::unique_ptr<MappedGallery> read_gallery(
+    const std::string& filename,
+    const std::string& networkVersion,
+    std::vector<User>& users
+) {
+    try {
+        std::unique_ptr<MappedGallery> gallery(new MappedGallery(filename));
+        if (gallery->network_version() != networkVersion) {
+            throw std::runtime_error(
+                std::string("Network version in the file distinguish from the current")
+            );
+        }
+
+        users.clear();
+        users.reserve(gallery->size());
+        for (size_t row = 0; row < gallery->size(); row++) {
+            User user;
+            user.parseMetadata(gallery->id(row), gallery->metadata(row));
+            users.push_back(user);
+        }
+
+        std::cout << "Users have been mapped from the file " << filename << std::endl;
+        return gallery;
+    } catch (std::exception& ex) {
+        users.clear();
+        std::cout << "Could not read users from the file " << filename << std::endl;
+        std::cout << ex.what() << std::endl;
+        return nullptr;
+    }
+}
+
+void write_gallery(
+    const std::vector<User>& users,
+    const FaceGallery& gallery,
+    const std::string& filename,
+    const std::string& networkVersion
+) {
+    std::map<unsigned int, const User*> by_id;
+    for (const User& user: users) {
+        by_id[user.id()] = &user;
+    }
+
+    write_gallery_file(filename, networkVersion, gallery, [&by_id](unsigned int id) {
+        const std::map<unsigned int, const User*>::const_iterator user = by_id.find(id);
+        return user != by_id.end() ? user->second->toMetadata() : User().toMetadata();
+    });
+}
+
+bool convert_users(
+    const std::string& jsonFile,
+    const std::string& galleryFile,
+    const std::string& networkVersion,
+    size_t dimension
+) {
+    // A missing or empty file has no users, it is not an error
+    std::vector<User> users;
+    try {
+        std::ifstream users_file(jsonFile, std::ios::in);
+        std::stringstream buffer;
+        if (users_file.is_open()) {
+            buffer << users_file.rdbuf();
+        }
+
+        if (buffer.str().find_first_not_of(" \t\r\n") != std::string::npos) {
+            users = parse_users(buffer.str(), networkVersion);
+        } else {
+            std::cout << "No users in the file " << jsonFile << std::endl;
+        }
+    } catch (std::exception& ex) {
+        std::cout << "Could not read users from the file " << jsonFile << std::endl;
+        std::cout << ex.what() << std::endl;
+        return false;
+    }
+
+    // Descriptors in the file define the dimension, the first one wins
+    for (const User& user: users) {
+        if (!user.descriptor().empty()) {
+            dimension = user.descriptor().size();
+            break;
+        }
+    }
+
+    std::vector<User> converted;
+    for (const User& user: users) {
+        if (user.descriptor().size() == dimension) {
+            converted.push_back(user);
+        }
+    }
+
+    try {
+        FaceGallery gallery(dimension);
+        for (const User& user: converted) {
+            gallery.add(user.id(), user.descriptor());
+        }
+
+        write_gallery(converted, gallery, galleryFile, networkVersion);
+    } catch (std::exception& ex) {
+        std::cout << "Could not write the gallery file " << galleryFile << std::endl;
+        std::cout << ex.what() << std::endl;
+        return false;
+    }
+
+    std::cout << "Converted " << converted.size() << " of " << users.size() << " users into " << galleryFile << std::endl;
+    return true;
+}
@@ -0,0 +1,76 @@
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <wiringPi.h>
+
+#include <wiringpi_gpio.hpp>
+
+// Inputs without an interrupt are read this often
+static const std::chrono::milliseconds POLL_PERIOD = std::chrono::milliseconds(10);
+
+std::mutex WiringPiGPIO::_mutex;
+std::condition_variable WiringPiGPIO::_edge;
+
+WiringPiGPIO::WiringPiGPIO() {
+    // Failed ISR setup has to return an error instead of terminating the process
+    setenv("WIRINGPI_CODES", "1", 0);
+    if (wiringPiSetup() < 0) {
+        throw std::runtime_error("Could not setup wiringPi");
+    }
+}
+
+void WiringPiGPIO::on_edge() {
+    // Taking the mutex orders the notification after the level check of a waiter
+    std::lock_guard<std::mutex> guard(WiringPiGPIO::_mutex);
+    WiringPiGPIO::_edge.notify_all();
+}
+
+void WiringPiGPIO::input(unsigned int pin) {
+    pinMode(pin, INPUT);
+    std::lock_guard<std::mutex> guard(WiringPiGPIO::_mutex);
+    if (this->_interrupts.count(pin)) {
+        return;
+    }
+
+    if (wiringPiISR(pin, INT_EDGE_BOTH, &WiringPiGPIO::on_edge) < 0) {
+        std::cout << "Could not setup an interrupt for GPIO " << pin << ", it will be polled" << std::endl;
+        return;
+    }
+
+    this->_interrupts.insert(pin);
+}
+
+void WiringPiGPIO::output(unsigned int pin) {
+    pinMode(pin, OUTPUT);
+}
+
+bool WiringPiGPIO::read(unsigned int pin) {
+    return digitalRead(pin) == HIGH;
+}
+
+void WiringPiGPIO::write(unsigned int pin, bool value) {
+    digitalWrite(pin, value ? HIGH : LOW);
+}
+
+bool WiringPiGPIO::wait_high(unsigned int pin, std::chrono::milliseconds timeout) {
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(WiringPiGPIO::_mutex);
+    const bool interrupt = this->_interrupts.count(pin) > 0;
+    while (digitalRead(pin) != HIGH) {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return false;
+        }
+
+        WiringPiGPIO::_edge.wait_until(lock, interrupt ? deadline : std::min(deadline, now + POLL_PERIOD));
+    }
+
+    return true;
+}
+
+bool WiringPiGPIO::closed() const {
+    return false;
+}
+
+WiringPiGPIO::~WiringPiGPIO() {}